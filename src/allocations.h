@@ -0,0 +1,80 @@
+#ifndef CUBE_SRC_ALLOCATIONS_H_
+#define CUBE_SRC_ALLOCATIONS_H_
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#include "engine/Memory.h"
+
+// Replacement global operator new/delete that count every allocation in
+// engine::HeapStats. A program may define them only once, so only the file
+// with main() includes this header.
+
+void* operator new(std::size_t size) {
+  engine::HeapStats::count(size);
+  if (void* block = std::malloc(size ? size : 1))
+    return block;
+  throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+  return ::operator new(size);
+}
+
+void* operator new(std::size_t size, std::align_val_t align) {
+  engine::HeapStats::count(size);
+  auto alignment = (std::size_t)align;
+  if (void* block = std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment))
+    return block;
+  throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size, std::align_val_t align) {
+  return ::operator new(size, align);
+}
+
+// GCC warns when it inlines one of these next to the matching new, it
+// cannot tell that both sides use malloc/free
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void operator delete(void* block) noexcept {
+  std::free(block);
+}
+
+void operator delete[](void* block) noexcept {
+  std::free(block);
+}
+
+void operator delete(void* block, std::size_t) noexcept {
+  std::free(block);
+}
+
+void operator delete[](void* block, std::size_t) noexcept {
+  std::free(block);
+}
+
+void operator delete(void* block, std::align_val_t) noexcept {
+  std::free(block);
+}
+
+void operator delete[](void* block, std::align_val_t) noexcept {
+  std::free(block);
+}
+
+void operator delete(void* block, std::size_t, std::align_val_t) noexcept {
+  std::free(block);
+}
+
+void operator delete[](void* block, std::size_t, std::align_val_t) noexcept {
+  std::free(block);
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#endif // CUBE_SRC_ALLOCATIONS_H_
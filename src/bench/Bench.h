@@ -0,0 +1,212 @@
+#ifndef CUBE_SRC_BENCH_BENCH_H_
+#define CUBE_SRC_BENCH_BENCH_H_
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "engine/Memory.h"
+
+namespace bench {
+// keeps the optimizer from dropping a computed value
+template <typename T>
+inline void doNotOptimize(const T& value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+struct s_config {
+  double warmup_ms = 100.0;
+  double min_time_ms = 50.0; // per repetition, the iteration count is scaled to reach it
+  int repetitions = 10;
+  std::string filter;
+};
+
+struct s_result {
+  std::string name;
+  std::uint64_t iterations = 0; // per repetition
+  int repetitions = 0;
+  double min_ns = 0.0;
+  double median_ns = 0.0;
+  double mean_ns = 0.0;
+  double stddev_ns = 0.0;
+  double max_ns = 0.0;
+  double allocs_per_op = 0.0; // global operator new calls
+};
+
+// `body(n)` runs the measured operation n times
+using BenchFn = std::function<void(std::uint64_t)>;
+
+inline double elapsedNs(const BenchFn& body, std::uint64_t n) {
+  auto start = std::chrono::steady_clock::now();
+  body(n);
+  auto end = std::chrono::steady_clock::now();
+  return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+}
+
+inline s_result run(const std::string& name, const BenchFn& body, const s_config& config) {
+  // warm up caches, allocators and drivers, then size a batch to min_time_ms
+  std::uint64_t n = 1;
+  double warm = 0.0;
+  while (warm < config.warmup_ms * 1e6) {
+    double t = elapsedNs(body, n);
+    warm += t;
+    if (t < config.min_time_ms * 1e6 / 4.0)
+      n *= 2;
+  }
+  double perOp = elapsedNs(body, n) / (double)n;
+  n = std::max<std::uint64_t>(1, (std::uint64_t)(config.min_time_ms * 1e6 / std::max(perOp, 1.0)));
+
+  std::vector<double> samples;
+  samples.reserve((std::size_t)config.repetitions);
+  std::uint64_t allocations = engine::HeapStats::threadAllocations();
+  for (int r = 0; r < config.repetitions; ++r)
+    samples.push_back(elapsedNs(body, n) / (double)n);
+  allocations = engine::HeapStats::threadAllocations() - allocations;
+  std::sort(samples.begin(), samples.end());
+
+  s_result result;
+  result.name = name;
+  result.iterations = n;
+  result.repetitions = config.repetitions;
+  result.min_ns = samples.front();
+  result.max_ns = samples.back();
+  result.allocs_per_op = (double)allocations / ((double)n * config.repetitions);
+  std::size_t mid = samples.size() / 2;
+  result.median_ns = samples.size() % 2 ? samples[mid] : (samples[mid - 1] + samples[mid]) / 2.0;
+  for (double s : samples)
+    result.mean_ns += s;
+  result.mean_ns /= (double)samples.size();
+  for (double s : samples)
+    result.stddev_ns += (s - result.mean_ns) * (s - result.mean_ns);
+  result.stddev_ns = samples.size() > 1 ? std::sqrt(result.stddev_ns / (double)(samples.size() - 1)) : 0.0;
+  return result;
+}
+
+inline void printHeader(std::ostream& out) {
+  char line[160];
+  std::snprintf(line, sizeof(line), "%-32s %12s %12s %12s %8s %10s %8s\n",
+                "benchmark", "median", "mean", "min", "cv", "iters", "allocs");
+  out << line;
+}
+
+inline std::string formatNs(double ns) {
+  char buf[32];
+  if (ns >= 1e6)
+    std::snprintf(buf, sizeof(buf), "%.3f ms", ns / 1e6);
+  else if (ns >= 1e3)
+    std::snprintf(buf, sizeof(buf), "%.3f us", ns / 1e3);
+  else
+    std::snprintf(buf, sizeof(buf), "%.1f ns", ns);
+  return buf;
+}
+
+inline void print(std::ostream& out, const s_result& r) {
+  char line[160];
+  std::snprintf(line, sizeof(line), "%-32s %12s %12s %12s %7.1f%% %10llu %8.2f\n", r.name.c_str(),
+                formatNs(r.median_ns).c_str(), formatNs(r.mean_ns).c_str(),
+                formatNs(r.min_ns).c_str(), r.mean_ns > 0.0 ? r.stddev_ns / r.mean_ns * 100.0 : 0.0,
+                (unsigned long long)r.iterations, r.allocs_per_op);
+  out << line << std::flush;
+}
+
+inline bool writeJson(const char* path, const std::vector<s_result>& results) {
+  std::ofstream out(path, std::ios::trunc);
+  if (!out) {
+    std::cerr << "ERROR::BENCH::JSON_NOT_WRITTEN " << path << std::endl;
+    return false;
+  }
+  out.precision(17);
+  out << "{\n  \"benchmarks\": [\n";
+  for (std::size_t i = 0; i < results.size(); ++i) {
+    const s_result& r = results[i];
+    out << "    {\"name\": \"" << r.name << "\", \"iterations\": " << r.iterations
+        << ", \"repetitions\": " << r.repetitions << ", \"min_ns\": " << r.min_ns
+        << ", \"median_ns\": " << r.median_ns << ", \"mean_ns\": " << r.mean_ns
+        << ", \"stddev_ns\": " << r.stddev_ns << ", \"max_ns\": " << r.max_ns
+        << ", \"allocs_per_op\": " << r.allocs_per_op << '}'
+        << (i + 1 < results.size() ? ",\n" : "\n");
+  }
+  out << "  ]\n}\n";
+  return true;
+}
+
+// reads back the files written by writeJson, one benchmark object per line
+inline bool readJson(const char* path, std::vector<s_result>& results) {
+  std::ifstream in(path);
+  if (!in) {
+    std::cerr << "ERROR::BENCH::JSON_NOT_READ " << path << std::endl;
+    return false;
+  }
+  auto number = [](const std::string& line, const char* key) {
+    std::string pattern = std::string("\"") + key + "\": ";
+    std::size_t at = line.find(pattern);
+    return at == std::string::npos ? 0.0 : std::strtod(line.c_str() + at + pattern.size(), nullptr);
+  };
+  std::string line;
+  while (std::getline(in, line)) {
+    std::size_t at = line.find("\"name\": \"");
+    if (at == std::string::npos)
+      continue;
+    at += 9;
+    s_result r;
+    r.name = line.substr(at, line.find('"', at) - at);
+    r.iterations = (std::uint64_t)number(line, "iterations");
+    r.repetitions = (int)number(line, "repetitions");
+    r.min_ns = number(line, "min_ns");
+    r.median_ns = number(line, "median_ns");
+    r.mean_ns = number(line, "mean_ns");
+    r.stddev_ns = number(line, "stddev_ns");
+    r.max_ns = number(line, "max_ns");
+    r.allocs_per_op = number(line, "allocs_per_op");
+    results.push_back(r);
+  }
+  return true;
+}
+
+// Compare two runs by median. A change is flagged when it exceeds
+// `threshold` (relative) and is larger than the combined noise of both runs
+// (two standard errors). More heap allocations per operation always count
+// as a regression. Returns the number of regressions.
+inline int compare(std::ostream& out, const std::vector<s_result>& base,
+                   const std::vector<s_result>& head, double threshold) {
+  int regressions = 0;
+  char line[200];
+  std::snprintf(line, sizeof(line), "%-32s %12s %12s %9s  %s\n", "benchmark", "base", "head", "change", "");
+  out << line;
+  for (const s_result& b : base) {
+    auto it = std::find_if(head.begin(), head.end(), [&](const s_result& h) { return h.name == b.name; });
+    if (it == head.end()) {
+      std::snprintf(line, sizeof(line), "%-32s %12s %12s\n", b.name.c_str(), formatNs(b.median_ns).c_str(), "missing");
+      out << line;
+      continue;
+    }
+    const s_result& h = *it;
+    double change = b.median_ns > 0.0 ? (h.median_ns - b.median_ns) / b.median_ns : 0.0;
+    double noise = 2.0 * std::sqrt(b.stddev_ns * b.stddev_ns / std::max(1, b.repetitions) +
+                                   h.stddev_ns * h.stddev_ns / std::max(1, h.repetitions));
+    bool significant = std::fabs(h.median_ns - b.median_ns) > noise && std::fabs(change) > threshold;
+    const char* verdict = !significant ? "" : change > 0.0 ? "REGRESSION" : "improvement";
+    if (significant && change > 0.0)
+      regressions++;
+    bool allocates = h.allocs_per_op > b.allocs_per_op + 0.01;
+    if (allocates) {
+      verdict = "ALLOCATION REGRESSION";
+      regressions++;
+    }
+    std::snprintf(line, sizeof(line), "%-32s %12s %12s %+8.1f%%  %s\n", b.name.c_str(),
+                  formatNs(b.median_ns).c_str(), formatNs(h.median_ns).c_str(), change * 100.0, verdict);
+    out << line;
+  }
+  return regressions;
+}
+}
+
+#endif // CUBE_SRC_BENCH_BENCH_H_
@@ -0,0 +1,366 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "glad/gl.h"
+#include "glfw/glfw3.h"
+
+#include "glm/glm.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+
+#include "engine/Jobs.h"
+#include "engine/MeshCache.h"
+
+#include "allocations.h"
+#include "callbacks.h"
+#include "hud.h"
+#include "options.h"
+#include "simulation.h"
+
+#include "Bench.h"
+
+struct s_bench_options {
+  bench::s_config config;
+  std::string json_path;
+  std::string compare_base, compare_head;
+  double threshold = 0.05;
+  bool cpu_only = false;
+};
+
+void print_bench_usage(const char* name) {
+  std::cout << "usage: " << name << " [options]\n"
+            << "       " << name << " --compare BASE.json HEAD.json [--threshold=0.05]\n"
+            << "  --filter=TEXT        run only benchmarks whose name contains TEXT\n"
+            << "  --repetitions=N      timed samples per benchmark (default 10)\n"
+            << "  --warmup-ms=N        untimed warmup per benchmark (default 100)\n"
+            << "  --min-time-ms=N      length of one sample (default 50)\n"
+            << "  --json=FILE          write the results to FILE\n"
+            << "  --cpu-only           skip the benchmarks that need a GL context\n"
+            << "  --threshold=X        relative change flagged by --compare (default 0.05)\n";
+}
+
+// OPTIONS_RUN to start, otherwise the program exits right away
+OptionsResult parse_bench_options(int argc, char** argv, s_bench_options* options) {
+  for (int i = 1; i < argc; ++i) {
+    const char* arg = argv[i];
+    const char* value = std::strchr(arg, '=');
+    std::string key = value ? std::string(arg, value - arg) : std::string(arg);
+    value = value ? value + 1 : "";
+
+    if (key == "--filter") {
+      options->config.filter = value;
+    } else if (key == "--repetitions") {
+      options->config.repetitions = std::atoi(value);
+    } else if (key == "--warmup-ms") {
+      options->config.warmup_ms = std::atof(value);
+    } else if (key == "--min-time-ms") {
+      options->config.min_time_ms = std::atof(value);
+    } else if (key == "--json") {
+      options->json_path = value;
+    } else if (key == "--cpu-only") {
+      options->cpu_only = true;
+    } else if (key == "--threshold") {
+      options->threshold = std::atof(value);
+    } else if (key == "--compare" && i + 2 < argc) {
+      options->compare_base = argv[++i];
+      options->compare_head = argv[++i];
+    } else if (key == "--help" || key == "-h") {
+      print_bench_usage(argv[0]);
+      return OPTIONS_HELP;
+    } else {
+      std::cerr << "ERROR::OPTIONS::UNKNOWN_OPTION " << arg << std::endl;
+      print_bench_usage(argv[0]);
+      return OPTIONS_ERROR;
+    }
+  }
+  if (options->config.repetitions < 2 || options->config.min_time_ms <= 0.0) {
+    std::cerr << "ERROR::OPTIONS::BAD_BENCH_CONFIG" << std::endl;
+    return OPTIONS_ERROR;
+  }
+  return OPTIONS_RUN;
+}
+
+int main(int argc, char** argv) {
+  s_bench_options options;
+  OptionsResult parsed = parse_bench_options(argc, argv, &options);
+  if (parsed != OPTIONS_RUN)
+    return parsed == OPTIONS_HELP ? 0 : 2; // 1 is taken by regressions
+
+  if (!options.compare_base.empty()) {
+    std::vector<bench::s_result> base, head;
+    if (!bench::readJson(options.compare_base.c_str(), base) ||
+        !bench::readJson(options.compare_head.c_str(), head))
+      return -1;
+    int regressions = bench::compare(std::cout, base, head, options.threshold);
+    std::cout << regressions << " significant regression(s)" << std::endl;
+    return regressions ? 1 : 0;
+  }
+
+  std::vector<bench::s_result> results;
+  auto run = [&](const char* name, const bench::BenchFn& body) {
+    if (!options.config.filter.empty() && std::string(name).find(options.config.filter) == std::string::npos)
+      return;
+    results.push_back(bench::run(name, body, options.config));
+    bench::print(std::cout, results.back());
+  };
+  bench::printHeader(std::cout);
+
+  // CPU only: the simulation copy of the puzzle never touches GL
+  {
+    engine::EntityStore store;
+    s_rubik rubik = make_rubik(&store, false);
+    std::uint64_t step = 0; // keeps whole 90 degree turns aligned across samples
+    run("rotate_rubik", [&](std::uint64_t n) {
+      for (std::uint64_t i = 0; i < n; ++i, ++step) {
+        rotate_rubik(&rubik, (RubikRoteGroup)(step / 90 % 9));
+        engine::update_entities(store);
+      }
+      bench::doNotOptimize(store.centers[0]);
+    });
+
+    // one full quarter turn through the move queue, 90 steps
+    free_rubik(&rubik);
+    rubik = make_rubik(&store, false);
+    run("logical_move", [&](std::uint64_t n) {
+      for (std::uint64_t i = 0; i < n; ++i) {
+        rubik.moves.push_back({(RubikRoteGroup)(i % 9), (i & 1) != 0, 0});
+        do {
+          step_rubik(&rubik);
+          engine::update_entities(store);
+        } while (rubik.remaining > 0);
+      }
+      bench::doNotOptimize(rubik_checksum(rubik));
+    });
+  }
+  {
+    // frustum culling of a 1000 puzzle store, a third of it off screen
+    engine::EntityStore store;
+    std::vector<s_rubik> puzzles;
+    for (int i = 0; i < 1000; ++i) {
+      puzzles.push_back(make_rubik(&store, false));
+      glm::vec3 offset((float)(i % 40) * 4.0f - 80.0f, (float)(i / 40) * 4.0f - 50.0f, 0.0f);
+      store.graph.setLocal(puzzles.back().node, glm::translate(glm::mat4(1.0f), offset));
+    }
+    engine::update_entities(store);
+    glm::mat4 viewProjection = glm::perspective(glm::radians(45.0f), 1.5f, 0.1f, 500.0f) *
+                               glm::lookAt(glm::vec3(0.0f, 0.0f, 120.0f), glm::vec3(0.0f),
+                                           glm::vec3(0.0f, 1.0f, 0.0f));
+    run("cull_entities/26000", [&](std::uint64_t n) {
+      std::size_t visible = 0;
+      for (std::uint64_t i = 0; i < n; ++i)
+        visible += engine::cull_entities(store, 0, store.size(), viewProjection);
+      bench::doNotOptimize(visible);
+    });
+
+    // the same culling split over the job system, 1, 2, 4... up to every hardware thread
+    unsigned hardware = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned threads = 1;; threads = std::min(threads * 2, hardware)) {
+      engine::JobSystem jobs(threads);
+      std::string name = "parallel_for/cull_26000/" + std::to_string(threads);
+      run(name.c_str(), [&](std::uint64_t n) {
+        std::atomic<std::size_t> visible{0};
+        for (std::uint64_t i = 0; i < n; ++i) {
+          jobs.parallel_for(0, store.size(), 1024, [&](std::size_t begin, std::size_t end) {
+            visible.fetch_add(engine::cull_entities(store, begin, end - begin, viewProjection),
+                              std::memory_order_relaxed);
+          });
+        }
+        bench::doNotOptimize(visible.load());
+      });
+      engine::s_job_stats stats = jobs.stats();
+      if (stats.executed)
+        std::cout << "  " << threads << " thread(s): " << stats.executed << " jobs, " << stats.steals << " steals ("
+                  << (100 * stats.steals / stats.executed) << "%), " << stats.contended << " contended, "
+                  << stats.sleeps << " sleeps" << std::endl;
+      if (threads == hardware)
+        break;
+    }
+    {
+      // cost of a job: 1000 empty ones, run and waited for
+      engine::JobSystem jobs;
+      run("JobSystem::run/1000", [&](std::uint64_t n) {
+        for (std::uint64_t i = 0; i < n; ++i) {
+          engine::JobCounter counter;
+          for (int job = 0; job < 1000; ++job)
+            jobs.run([] {}, &counter);
+          jobs.wait(counter);
+        }
+      });
+    }
+
+    // one frame of draw commands for the same store: fill, radix sort, clear
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 120.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    engine::RenderQueue queue;
+    run("RenderQueue::sort/26000", [&](std::uint64_t n) {
+      std::size_t sorted = 0;
+      for (std::uint64_t i = 0; i < n; ++i) {
+        for (std::uint32_t id = 0; id < store.size(); ++id) {
+          float depth = -(view * glm::vec4(store.centers[id], 1.0f)).z;
+          queue.push(0, {engine::RenderKey::make(engine::PASS_OPAQUE, 1 + id % 2, 0, depth, id), nullptr,
+                         nullptr, &store.graph.world(store.nodes[id])});
+        }
+        sorted += queue.sort();
+        queue.clear();
+        engine::FrameArena::thread().reset();
+      }
+      bench::doNotOptimize(sorted);
+    });
+
+    // the arrow keys turn one puzzle: its node and 26 cubies are recomputed
+    std::uint64_t frame = 0;
+    run("update_entities/turn_view", [&](std::uint64_t n) {
+      for (std::uint64_t i = 0; i < n; ++i, ++frame) {
+        store.graph.setLocal(puzzles[frame % puzzles.size()].node,
+                             glm::rotate(glm::mat4(1.0f), glm::radians((float)(frame % 360)),
+                                         glm::vec3(0.0f, 1.0f, 0.0f)));
+        engine::update_entities(store);
+      }
+      bench::doNotOptimize(store.centers[0]);
+    });
+  }
+  {
+    engine::primitives::RubikAtomCube cube({1.05f, 1.05f, 1.05f}, {1, 1, 1});
+    run("RubikAtomCube::rotateXYZ", [&](std::uint64_t n) {
+      for (std::uint64_t i = 0; i < n; ++i)
+        cube.rotateXYZ({0.0f, 1.0f, 0.0f}, 1.0f);
+      bench::doNotOptimize(cube.getPosition());
+    });
+  }
+  {
+    // 10000 instances of two shapes resolve to two meshes
+    engine::MeshCache cache;
+    const engine::primitives::s_primitive shapes[2] = {
+        engine::primitives::box({1.0f, 1.0f, 1.0f}),
+        engine::primitives::beveled_box({1.0f, 1.0f, 1.0f}, 0.08f),
+    };
+    run("MeshCache::get/10000", [&](std::uint64_t n) {
+      std::uint64_t sum = 0;
+      for (std::uint64_t i = 0; i < n; ++i)
+        for (std::uint32_t instance = 0; instance < 10000; ++instance)
+          sum += cache.get(shapes[instance & 1]);
+      bench::doNotOptimize(sum);
+    });
+    std::cout << "  " << cache.requests() << " requests, " << cache.meshes() << " meshes, " << cache.bytes()
+              << " bytes" << std::endl;
+
+    run("make_beveled_box/4", [&](std::uint64_t n) {
+      std::size_t vertices = 0;
+      for (std::uint64_t i = 0; i < n; ++i)
+        vertices += engine::primitives::make_mesh(shapes[1]).vertices.size();
+      bench::doNotOptimize(vertices);
+    });
+  }
+
+  if (options.cpu_only) {
+    if (!options.json_path.empty() && !bench::writeJson(options.json_path.c_str(), results))
+      return -1;
+    return 0;
+  }
+
+  // GL: a hidden window provides the context, vsync off so swaps do not wait
+  glfwInit();
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+  glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+  GLFWwindow* window = glfwCreateWindow(1080, 720, "cube_bench", nullptr, nullptr);
+  if (!window) {
+    std::cerr << "BENCH::ERROR: no GL context, run with --cpu-only" << std::endl;
+    glfwTerminate();
+    return -1;
+  }
+  glfwMakeContextCurrent(window);
+  glfwSwapInterval(0);
+  if (!gladLoadGL(glfwGetProcAddress)) {
+    std::cerr << "GLAD::ERROR: Failed to initialize GLAD" << std::endl;
+    return -1;
+  }
+  glEnable(GL_DEPTH_TEST);
+  glDepthFunc(GL_LESS);
+
+  {
+    engine::Shader shader("../src/shaders/rubikVertex.glsl", "../src/shaders/rubikFragment.glsl");
+    shader.use();
+    glm::mat4 model = glm::rotate(glm::mat4(1.0f), 0.5f, glm::vec3(0.0f, 1.0f, 0.0f));
+    run("Shader::setMat4", [&](std::uint64_t n) {
+      for (std::uint64_t i = 0; i < n; ++i)
+        shader.setMat4("model", model);
+      glFinish();
+    });
+    shader.release();
+  }
+  {
+    // the overlay rebuilt from scratch and drawn, the most a frame with it shown pays
+    engine::JobSystem jobs;
+    engine::AssetLoader assets(jobs);
+    engine::Overlay overlay;
+    overlay.init(assets, "../src/shaders/overlayVertex.glsl", "../src/shaders/overlayFragment.glsl");
+    assets.finishAll();
+    overlay.setVisible(true);
+    s_hud hud;
+    int w, h;
+    glfwGetFramebufferSize(window, &w, &h);
+    run("Overlay::build+draw", [&](std::uint64_t n) {
+      for (std::uint64_t i = 0; i < n; ++i) {
+        hud.last_update = 0; // skip the rebuild rate limit
+        update_hud(&hud, &overlay, hud.budget_ms, {});
+        overlay.draw(w, h);
+      }
+      glFinish();
+    });
+    overlay.release();
+    assets.release();
+  }
+  {
+    // simulation tick, snapshot hand-off and the scene draw, kept busy with turns
+    engine::EntityStore scene;
+    s_rubik rubik = make_rubik(&scene);
+    s_simulation sim;
+    sim.rubik = make_rubik(&sim.cubies, false);
+    int w, h;
+    glfwGetFramebufferSize(window, &w, &h);
+    for (auto* mesh : scene.meshes)
+      mesh->setPerspective(45.0f, (float)w / (float)h, 0.1f, 100.0f);
+    const engine::Camera& camera = scene.meshes[0]->getCamera();
+    glm::mat4 viewProjection = camera.getProjection() * camera.getView();
+    engine::RenderQueue queue;
+
+    run("frame", [&](std::uint64_t n) {
+      for (std::uint64_t i = 0; i < n; ++i) {
+        if (sim.rubik.moves.empty())
+          sim.rubik.moves.push_back({(RubikRoteGroup)(sim.tick % 9), false, 0});
+        simulate_tick(&sim);
+        publish_snapshot(&sim);
+        if (sim.snapshots.acquire()) {
+          apply_snapshot(&scene, sim.snapshots.front());
+          scene.graph.setLocal(rubik.node, sim.snapshots.front().model);
+          rubik.turns = sim.snapshots.front().turns[0];
+        }
+        engine::update_entities(scene);
+
+        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        queue_rubik(rubik, camera.getView(), viewProjection, queue);
+        queue.sort();
+        queue.submit(camera.getView(), camera.getProjection());
+        queue.clear();
+        glfwSwapBuffers(window);
+        engine::FrameStats::endFrame();
+        engine::FrameArena::thread().reset();
+      }
+      glFinish();
+    });
+    scene.release();
+  }
+
+  engine::GLRegistry::reportLeaks(std::cerr);
+  glfwTerminate();
+  if (!options.json_path.empty() && !bench::writeJson(options.json_path.c_str(), results))
+    return -1;
+  return 0;
+}
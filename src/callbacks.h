@@ -1,26 +1,100 @@
 #ifndef CUBE_SRC_CALLBACKS_H_
 #define CUBE_SRC_CALLBACKS_H_
 
+#include <array>
+#include <cassert>
 #include <chrono>
 #include <cmath>
+#include <cstdint>
+#include <memory>
 
 #include "glad/gl.h"
 #include "glfw/glfw3.h"
 
 #include "glm/glm.hpp"
+#include "glm/gtc/matrix_transform.hpp"
 
 #include "engine/Camera.h"
+#include "engine/EntityStore.h"
+#include "engine/Input.h"
+#include "engine/Memory.h"
+#include "engine/Profiler.h"
+#include "engine/RenderQueue.h"
+#include "engine/SceneGraph.h"
+#include "engine/StaticBatch.h"
 #include "engine/primitives/RubikAtomCube.h"
 
+enum RubikRoteGroup {
+  FRONT = 0,
+  BACK = 1,
+  RIGHT = 2,
+  LEFT = 3,
+  TOP = 4,
+  BOTTOM = 5,
+  CENTER_F = 6,
+  CENTER_R = 7,
+  CENTER_T = 8,
+};
+
+struct s_move {
+  RubikRoteGroup group = FRONT;
+  bool reversed = false;
+  std::int64_t input_ns = 0; // arrival time of the key event that queued it
+};
+
+// distance between neighbouring cubie centers
+constexpr float kCubieSpacing = 1.05f;
+
+// One puzzle: a node of the store's scene graph with its cubies below it,
+// a range of entities in that store, plus the turn state.
 struct s_rubik {
-  std::vector<engine::primitives::RubikAtomCube*> cubes;
-  std::vector<int> front, back, right, left, top, bottom, center_f, center_r, center_t;
+  engine::EntityStore* store = nullptr;
+  std::uint32_t node = engine::SceneGraph::kNone;
+  // while a layer turns its cubies hang below this temporary node
+  std::uint32_t pivot = engine::SceneGraph::kNone;
+  std::uint32_t first = 0, count = 0; // entities first .. first + count - 1
+  // entity ids of each layer
+  std::vector<std::uint32_t> front, back, right, left, top, bottom, center_f, center_r, center_t;
+
+  glm::mat4 model{1.0f}; // view rotation, changed by the arrow keys
 
   int rotation_counter = 0;
+
+  engine::RingQueue<s_move> moves; // turns waiting for the current one to finish
+  s_move current;
+  int remaining = 0; // degrees left of the current turn
+  std::uint32_t turns = 0; // turns started, render copies take it from the snapshots
+
+  // render copies: the cubies outside the last turning layer, rebuilt when
+  // `turns` moves on (bake_rubik)
+  std::unique_ptr<engine::StaticBatch> batch;
 };
 
-struct s_rubik make_rubik() {
+// Append a puzzle to `store`. `with_gl` is false for the simulation copy,
+// which is never drawn and so needs no meshes or shader program; `shader`
+// lets several puzzles share one. The simulation works in puzzle space and
+// keeps its puzzle node at identity, render copies are placed by `model`.
+struct s_rubik make_rubik(engine::EntityStore* store, bool with_gl = true,
+                          std::shared_ptr<engine::Shader> shader = nullptr) {
   struct s_rubik rubik;
+  rubik.store = store;
+  rubik.first = (std::uint32_t)store->size();
+
+  // every cube draws with the same program
+  if (with_gl && !shader)
+    shader = std::make_shared<engine::Shader>("../src/shaders/rubikVertex.glsl",
+                                              "../src/shaders/rubikFragment.glsl");
+
+  engine::Camera camera;
+  camera.move(glm::vec3(0.0f, 0.0f, 10.0f));
+  camera.rotate(glm::vec3(1.0f, 0.0f, 0.0f), 30.0f);
+  camera.rotate(glm::vec3(0.0f, 1.0f, 0.0f), -30.0f);
+
+  camera.setView(glm::vec3(0.0f, 0.0f, 10.0f),
+                 glm::vec3(0.0f),
+                 glm::vec3(0.0f, 1.0f, 0.0f));
+  rubik.model = camera.getModel();
+  rubik.node = store->graph.create(engine::SceneGraph::kRoot, with_gl ? rubik.model : glm::mat4(1.0f));
 
   for (int x = -1; x <= 1; x++) {
     for (int y = -1; y <= 1; y++) {
@@ -28,23 +102,8 @@ struct s_rubik make_rubik() {
         if (x == 0 && y == 0 && z == 0)
           continue;
 
-        auto *cube = new engine::primitives::RubikAtomCube(glm::vec3{x, y, z} *
-                                                  glm::vec3(1 * 1.05f),
-                                                  {1, 1, 1});
-        engine::Camera camera;
-        camera.move(glm::vec3(0.0f, 0.0f, 10.0f));
-        camera.rotate(glm::vec3(1.0f, 0.0f, 0.0f), 30.0f);
-        camera.rotate(glm::vec3(0.0f, 1.0f, 0.0f), -30.0f);
-
-        camera.setView(glm::vec3(0.0f, 0.0f, 10.0f),
-                       glm::vec3(0.0f),
-                       glm::vec3(0.0f, 1.0f, 0.0f));
-
-        cube->setCamera(camera);
-        cube->createShader("../src/shaders/rubikVertex.glsl",
-                           "../src/shaders/rubikFragment.glsl");
-
-        std::vector<glm::vec3> colors{
+        auto id = (std::uint32_t)store->size();
+        std::array<glm::vec3, engine::EntityStore::kFaces> colors{{
             {1.0f, 1.0f, 1.0f},     // 0 - front
             {0.68f, 0.07f, 0.08f},  // 1 - right
             {0.05f, 0.28f, 0.67f},  // 2 - back
@@ -52,67 +111,122 @@ struct s_rubik make_rubik() {
             {1.0f, 0.34f, 0.14f},   // 3 - left
             {0.1f, 0.61f, 0.3f},    // 4 - top
             {1.0f, 0.84f, 0.18f},   // 5 - bottom
-        };
+        }};
 
         if (y == -1) {
           colors[4] = {0.0f, 0.0f, 0.0f};
-          rubik.bottom.push_back((int)rubik.cubes.size());
+          rubik.bottom.push_back(id);
         } else if (y == 0) {
           colors[4] = {0.0f, 0.0f, 0.0f};
           colors[5] = {0.0f, 0.0f, 0.0f};
-          rubik.center_r.push_back((int)rubik.cubes.size());
+          rubik.center_r.push_back(id);
         } else {
           colors[5] = {0.0f, 0.0f, 0.0f};
-          rubik.top.push_back((int)rubik.cubes.size());
+          rubik.top.push_back(id);
         }
 
         if (x == -1) {
           colors[1] = {0.0f, 0.0f, 0.0f};
-          rubik.left.push_back((int)rubik.cubes.size());
+          rubik.left.push_back(id);
         } else if (x == 0){
           colors[3] = {0.0f, 0.0f, 0.0f};
           colors[1] = {0.0f, 0.0f, 0.0f};
-          rubik.center_f.push_back((int)rubik.cubes.size());
+          rubik.center_f.push_back(id);
         } else {
           colors[3] = {0.0f, 0.0f, 0.0f};
-          rubik.right.push_back((int)rubik.cubes.size());
+          rubik.right.push_back(id);
         }
 
         if (z == -1) {
           colors[0] = {0.0f, 0.0f, 0.0f};
-          rubik.front.push_back((int)rubik.cubes.size());
+          rubik.front.push_back(id);
         } else if (z == 0){
           colors[0] = {0.0f, 0.0f, 0.0f};
           colors[2] = {0.0f, 0.0f, 0.0f};
-          rubik.center_t.push_back((int)rubik.cubes.size());
+          rubik.center_t.push_back(id);
         } else {
           colors[2] = {0.0f, 0.0f, 0.0f};
-          rubik.back.push_back((int)rubik.cubes.size());
+          rubik.back.push_back(id);
         }
 
-        cube->setColors(colors);
+        // only the stickers are always in sight, the inner faces are shown
+        // while a turn opens them up (expose_turning_faces)
+        using namespace engine::primitives;
+        std::uint8_t outer = 0;
+        if (x != 0)
+          outer |= 1 << (x < 0 ? FACE_NEG_X : FACE_POS_X);
+        if (y != 0)
+          outer |= 1 << (y < 0 ? FACE_NEG_Y : FACE_POS_Y);
+        if (z != 0)
+          outer |= 1 << (z < 0 ? FACE_NEG_Z : FACE_POS_Z);
 
-        rubik.cubes.push_back(cube);
+        store->create(rubik.node, glm::vec3{x, y, z} * kCubieSpacing, {1, 1, 1}, colors, outer);
+        if (with_gl)
+          store->attachMesh(id, shader, camera);
       }
     }
   }
+  if (with_gl)
+    rubik.batch = std::make_unique<engine::StaticBatch>();
+  rubik.count = (std::uint32_t)store->size() - rubik.first;
   return rubik;
 }
 
-enum RubikRoteGroup {
-  FRONT = 0,
-  BACK = 1,
-  RIGHT = 2,
-  LEFT = 3,
-  TOP = 4,
-  BOTTOM = 5,
-  CENTER_F = 6,
-  CENTER_R = 7,
-  CENTER_T = 8,
-};
+// Remove a puzzle with its nodes and meshes. The store is truncated, so
+// only the newest puzzle of a store may be freed; free them in reverse
+// order of creation, as stress_free() and main() do.
+void free_rubik(struct s_rubik *rubik) {
+  assert(rubik->first + rubik->count == rubik->store->size() && "free the newest puzzle of the store first");
+  rubik->batch.reset();
+  rubik->store->truncate(rubik->first);
+  rubik->store->graph.destroy(rubik->pivot);
+  rubik->store->graph.destroy(rubik->node);
+  rubik->pivot = rubik->node = engine::SceneGraph::kNone;
+}
+
+std::vector<std::uint32_t>& rubik_layer(struct s_rubik *rubik, enum RubikRoteGroup group) {
+  switch (group) {
+    case FRONT:
+      return rubik->front;
+    case BACK:
+      return rubik->back;
+    case RIGHT:
+      return rubik->right;
+    case LEFT:
+      return rubik->left;
+    case TOP:
+      return rubik->top;
+    case BOTTOM:
+      return rubik->bottom;
+    case CENTER_F:
+      return rubik->center_f;
+    case CENTER_R:
+      return rubik->center_r;
+    case CENTER_T:
+    default:
+      return rubik->center_t;
+  }
+}
+
+// a cubie transform after a quarter turn: rotation entries are exactly
+// -1, 0 or 1 and the position sits on the cubie grid, so no error builds up
+glm::mat4 snap_cubie(const glm::mat4& transform) {
+  glm::mat4 snapped(1.0f);
+  for (int c = 0; c < 3; ++c) {
+    for (int r = 0; r < 3; ++r)
+      snapped[c][r] = std::round(transform[c][r]);
+    snapped[3][c] = std::round(transform[3][c] / kCubieSpacing) * kCubieSpacing;
+  }
+  return snapped;
+}
 
+// Turn a layer by one degree. The layer's cubies are moved below a pivot
+// node at the first degree; each step then only changes the pivot, and the
+// scene graph recomputes the pivot and its nine children. After the 90th
+// degree the turn is baked into the cubies and the pivot is dropped.
 void rotate_rubik(struct s_rubik *rubik, enum RubikRoteGroup rotate_group,
                   bool negative = false) {
+  PROFILE_FUNCTION();
   glm::vec3 rotate_point[] = {
       {0, 0, 1},
       {0, 0, -1},
@@ -124,82 +238,332 @@ void rotate_rubik(struct s_rubik *rubik, enum RubikRoteGroup rotate_group,
       {0, 1, 0},
       {0, 0, 1},
   };
-  std::vector<int> indexes;
-  switch (rotate_group) {
-    case FRONT:
-      indexes = rubik->front;
-      break;
-    case BACK:
-      indexes = rubik->back;
-      break;
-    case RIGHT:
-      indexes = rubik->right;
-      break;
-    case LEFT:
-      indexes = rubik->left;
-      break;
-    case TOP:
-      indexes = rubik->top;
-      break;
-    case BOTTOM:
-      indexes = rubik->bottom;
+  engine::EntityStore& store = *rubik->store;
+  engine::SceneGraph& graph = store.graph;
+
+  if (rubik->pivot == engine::SceneGraph::kNone) {
+    rubik->pivot = graph.create(rubik->node);
+    for (std::uint32_t id : rubik_layer(rubik, rotate_group))
+      graph.setParent(store.nodes[id], rubik->pivot);
+  }
+  float angle = (float)++rubik->rotation_counter;
+  graph.setLocal(rubik->pivot, glm::rotate(glm::mat4(1.0f), glm::radians(negative ? -angle : angle),
+                                           rotate_point[rotate_group]));
+  if (rubik->rotation_counter < 90)
+    return;
+
+  rubik->rotation_counter = 0;
+  const glm::mat4 turn = graph.local(rubik->pivot);
+  std::uint32_t child = graph.firstChild(rubik->pivot);
+  while (child != engine::SceneGraph::kNone) {
+    std::uint32_t next = graph.nextSibling(child);
+    graph.setLocal(child, snap_cubie(turn * graph.local(child)));
+    graph.setParent(child, rubik->node);
+    child = next;
+  }
+  graph.destroy(rubik->pivot);
+  rubik->pivot = engine::SceneGraph::kNone;
+
+  // recalculate groups
+  rubik->front.clear();
+  rubik->back.clear();
+  rubik->right.clear();
+  rubik->left.clear();
+  rubik->top.clear();
+  rubik->bottom.clear();
+  rubik->center_f.clear();
+  rubik->center_r.clear();
+  rubik->center_t.clear();
+
+  for (std::uint32_t i = rubik->first; i < rubik->first + rubik->count; ++i) {
+    // position inside the puzzle, the local matrix now that the pivot is gone
+    glm::vec3 pos = glm::round(glm::vec3(graph.local(store.nodes[i])[3]) / kCubieSpacing);
+    if ((int)pos.y == -1) {
+      rubik->bottom.push_back(i);
+    } else if ((int)pos.y == 0) {
+      rubik->center_r.push_back(i);
+    } else {
+      rubik->top.push_back(i);
+    }
+
+    if ((int)pos.x == -1) {
+      rubik->left.push_back(i);
+    } else if ((int)pos.x == 0){
+      rubik->center_f.push_back(i);
+    } else {
+      rubik->right.push_back(i);
+    }
+
+    if ((int)pos.z == -1) {
+      rubik->front.push_back(i);
+    } else if ((int)pos.z == 0){
+      rubik->center_t.push_back(i);
+    } else {
+      rubik->back.push_back(i);
+    }
+  }
+}
+
+// advance the turn animation by one simulation step, starting the next
+// queued move when the previous one has finished;
+// returns true when `rubik->current` was started by this step
+bool step_rubik(struct s_rubik *rubik) {
+  bool started = false;
+  if (rubik->remaining <= 0 && !rubik->moves.empty()) {
+    rubik->current = rubik->moves.front();
+    rubik->moves.pop_front();
+    rubik->remaining = 90;
+    rubik->turns++;
+    started = true;
+  }
+
+  if (rubik->remaining > 0) {
+    rotate_rubik(rubik, rubik->current.group, rubik->current.reversed);
+    rubik->remaining -= 1;
+  }
+  return started;
+}
+
+enum RubikAction {
+  ACTION_TURN,
+  ACTION_VIEW,
+  ACTION_TOGGLE_DIRECTION,
+  // handled by the render thread, forwarded through s_controls::commands
+  ACTION_REPORT_LATENCY,
+  ACTION_TOGGLE_PROFILER,
+  ACTION_DUMP_TRACE,
+  ACTION_TOGGLE_OVERLAY,
+  ACTION_REPORT_GL,
+  ACTION_CAPTURE,
+};
+
+struct s_key_binding {
+  int key;
+  RubikAction action;
+  RubikRoteGroup group; // ACTION_TURN
+  glm::vec3 axis;       // ACTION_VIEW, rotated by `angle` every step while held
+  float angle;
+};
+
+const s_key_binding key_bindings[] = {
+    {GLFW_KEY_RIGHT, ACTION_VIEW, FRONT, {0.0f, 1.0f, 0.0f}, 1.0f},
+    {GLFW_KEY_LEFT, ACTION_VIEW, FRONT, {0.0f, 1.0f, 0.0f}, -1.0f},
+    {GLFW_KEY_UP, ACTION_VIEW, FRONT, {1.0f, 0.0f, 0.0f}, 1.0f},
+    {GLFW_KEY_DOWN, ACTION_VIEW, FRONT, {1.0f, 0.0f, 0.0f}, -1.0f},
+
+    {GLFW_KEY_Q, ACTION_TURN, FRONT, {}, 0.0f},
+    {GLFW_KEY_W, ACTION_TURN, BACK, {}, 0.0f},
+    {GLFW_KEY_E, ACTION_TURN, RIGHT, {}, 0.0f},
+    {GLFW_KEY_A, ACTION_TURN, LEFT, {}, 0.0f},
+    {GLFW_KEY_S, ACTION_TURN, TOP, {}, 0.0f},
+    {GLFW_KEY_D, ACTION_TURN, BOTTOM, {}, 0.0f},
+    {GLFW_KEY_Z, ACTION_TURN, CENTER_F, {}, 0.0f},
+    {GLFW_KEY_X, ACTION_TURN, CENTER_R, {}, 0.0f},
+    {GLFW_KEY_C, ACTION_TURN, CENTER_T, {}, 0.0f},
+
+    {GLFW_KEY_SPACE, ACTION_TOGGLE_DIRECTION, FRONT, {}, 0.0f},
+    {GLFW_KEY_L, ACTION_REPORT_LATENCY, FRONT, {}, 0.0f},
+    {GLFW_KEY_F9, ACTION_TOGGLE_PROFILER, FRONT, {}, 0.0f},
+    {GLFW_KEY_P, ACTION_DUMP_TRACE, FRONT, {}, 0.0f},
+    {GLFW_KEY_F1, ACTION_TOGGLE_OVERLAY, FRONT, {}, 0.0f},
+    {GLFW_KEY_G, ACTION_REPORT_GL, FRONT, {}, 0.0f},
+    {GLFW_KEY_F12, ACTION_CAPTURE, FRONT, {}, 0.0f},
+};
+
+const s_key_binding* find_binding(int key) {
+  for (const auto& binding : key_bindings) {
+    if (binding.key == key)
+      return &binding;
+  }
+  return nullptr;
+}
+
+struct s_controls {
+  std::array<bool, GLFW_KEY_LAST + 1> held{};
+  bool is_reversed = false;
+  std::vector<RubikAction> commands; // actions for the render thread
+};
+
+void handle_input_event(struct s_rubik *rubik, s_controls *controls,
+                        const engine::s_input_event& event) {
+  if (event.key < 0 || event.key > GLFW_KEY_LAST)
+    return;
+
+  if (event.action == GLFW_RELEASE) {
+    controls->held[event.key] = false;
+    return;
+  }
+  if (event.action != GLFW_PRESS)
+    return; // key repeat is covered by the held state
+
+  controls->held[event.key] = true;
+  const s_key_binding* binding = find_binding(event.key);
+  if (!binding)
+    return;
+
+  switch (binding->action) {
+    case ACTION_TURN:
+      rubik->moves.push_back({binding->group, controls->is_reversed, event.time_ns});
       break;
-    case CENTER_F:
-      indexes = rubik->center_f;
+    case ACTION_TOGGLE_DIRECTION:
+      controls->is_reversed = !controls->is_reversed;
       break;
-    case CENTER_R:
-      indexes = rubik->center_r;
+    case ACTION_VIEW:
       break;
-    case CENTER_T:
-      indexes = rubik->center_t;
+    default:
+      controls->commands.push_back(binding->action);
       break;
   }
+}
+
+void apply_held_keys(struct s_rubik *rubik, const s_controls& controls) {
+  for (const auto& binding : key_bindings) {
+    if (binding.action != ACTION_VIEW || !controls.held[binding.key])
+      continue;
+    rubik->model = glm::rotate(rubik->model, glm::radians(binding.angle), binding.axis);
+  }
+}
 
-  if (++rubik->rotation_counter >= 90) {
-    rubik->rotation_counter = 0;
-    // recalculate groups
-    rubik->front.clear();
-    rubik->back.clear();
-    rubik->right.clear();
-    rubik->left.clear();
-    rubik->top.clear();
-    rubik->bottom.clear();
-    rubik->center_f.clear();
-    rubik->center_r.clear();
-    rubik->center_t.clear();
-
-    int i = 0;
-    for (auto& cube : rubik->cubes) {
-      glm::vec3 pos = cube->getPosition();
-      if ((int)pos.y == -1) {
-        rubik->bottom.push_back(i);
-      } else if ((int)pos.y == 0) {
-        rubik->center_r.push_back(i);
-      } else {
-        rubik->top.push_back(i);
-      }
+// FNV-1a over the quantized cube positions and the pending turns,
+// used to check that a replayed session ends in the recorded state;
+// the positions are the centers of the last update_entities()
+std::uint64_t rubik_checksum(const struct s_rubik& rubik) {
+  std::uint64_t hash = 14695981039346656037ull;
+  auto mix = [&hash](std::int64_t v) {
+    for (int i = 0; i < 8; ++i) {
+      hash ^= (std::uint64_t)(v >> (i * 8)) & 0xff;
+      hash *= 1099511628211ull;
+    }
+  };
+  for (std::uint32_t i = rubik.first; i < rubik.first + rubik.count; ++i) {
+    glm::vec3 pos = rubik.store->centers[i];
+    mix(std::llround(pos.x * 1000.0f));
+    mix(std::llround(pos.y * 1000.0f));
+    mix(std::llround(pos.z * 1000.0f));
+  }
+  mix(rubik.remaining);
+  mix((std::int64_t)rubik.moves.size());
+  return hash;
+}
+
+// the layer a puzzle is turning, axis -1 when it rests
+struct s_turning_layer {
+  int axis = -1;
+  int layer = 0; // -1, 0 or 1 along the axis
+
+  // distance of a cubie from the layer along the axis, in layers
+  [[nodiscard]] int offset(const glm::mat4& local) const {
+    return (int)std::round(local[3][axis] / kCubieSpacing) - layer;
+  }
+};
 
-      if ((int)pos.x == -1) {
-        rubik->left.push_back(i);
-      } else if ((int)pos.x == 0){
-        rubik->center_f.push_back(i);
-      } else {
-        rubik->right.push_back(i);
+// Find the turning layer from the puzzle space transforms alone, so render
+// copies that only receive snapshots can use it: while a layer turns, its
+// cubies' rotations stay on the grid along the turn axis only.
+s_turning_layer find_turning_layer(const struct s_rubik& rubik) {
+  const engine::EntityStore& store = *rubik.store;
+  auto snapped = [](float v) { return std::abs(v - std::round(v)) < 1e-5f; };
+  s_turning_layer turning;
+  for (std::uint32_t i = rubik.first; i < rubik.first + rubik.count; ++i) {
+    const glm::mat4& local = store.graph.local(store.nodes[i]);
+    int rows = 0, row = 0;
+    for (int r = 0; r < 3; ++r) {
+      if (snapped(local[0][r]) && snapped(local[1][r]) && snapped(local[2][r])) {
+        rows++;
+        row = r;
       }
+    }
+    if (rows == 1) {
+      turning.axis = row;
+      turning.layer = (int)std::round(local[3][row] / kCubieSpacing);
+      break;
+    }
+  }
+  return turning;
+}
 
-      if ((int)pos.z == -1) {
-        rubik->front.push_back(i);
-      } else if ((int)pos.z == 0){
-        rubik->center_t.push_back(i);
-      } else {
-        rubik->back.push_back(i);
+// Show the inner faces a turn opens up and hide them again once it ends.
+// The turning layer and the layers next to it face each other across the
+// gaps and draw the faces pointing over them; every other cubie draws just
+// its stickers.
+void expose_turning_faces(const struct s_rubik& rubik, const s_turning_layer& turning) {
+  engine::EntityStore& store = *rubik.store;
+  for (std::uint32_t i = rubik.first; i < rubik.first + rubik.count; ++i) {
+    engine::primitives::RubikAtomCube* mesh = store.meshes[i];
+    if (!mesh)
+      continue;
+    std::uint8_t faces = store.faces[i];
+    if (turning.axis >= 0) {
+      const glm::mat4& local = store.graph.local(store.nodes[i]);
+      int offset = turning.offset(local);
+      // the turn axis in the cubie's own space: a row of its rotation
+      glm::vec3 direction(local[0][turning.axis], local[1][turning.axis], local[2][turning.axis]);
+      if (offset == 0) {
+        if (turning.layer > -1)
+          faces |= 1 << engine::primitives::RubikAtomCube::faceAlong(-direction);
+        if (turning.layer < 1)
+          faces |= 1 << engine::primitives::RubikAtomCube::faceAlong(direction);
+      } else if (offset == 1 || offset == -1) {
+        faces |= 1 << engine::primitives::RubikAtomCube::faceAlong(direction * (float)-offset);
       }
-      i++;
     }
+    if (mesh->getFaces() != faces)
+      mesh->setFaces(faces);
+  }
+}
+
+// Merge every cubie outside the turning layer into the puzzle's static
+// batch, in puzzle space. They stay put until another layer turns, which
+// starts a new turn and so a new bake; until then the batch is one draw and
+// only the turning layer is drawn cubie by cubie.
+void bake_rubik(const struct s_rubik& rubik, const s_turning_layer& turning) {
+  PROFILE_FUNCTION();
+  engine::EntityStore& store = *rubik.store;
+  rubik.batch->begin(rubik.turns);
+  for (std::uint32_t i = rubik.first; i < rubik.first + rubik.count; ++i) {
+    const glm::mat4& local = store.graph.local(store.nodes[i]);
+    store.flags[i] &= ~engine::ENTITY_BAKED;
+    if (!store.meshes[i] || (turning.axis >= 0 && turning.offset(local) == 0))
+      continue;
+    rubik.batch->add(*store.meshes[i], local);
+    store.flags[i] |= engine::ENTITY_BAKED;
   }
+}
+
+// cull the puzzle's entities against the camera and queue a draw of the
+// store's cached box for each visible one, keyed by program and distance;
+// baked cubies are queued as one draw of the batch when any of them is
+// visible. update_entities() must have run since the last change.
+// `producer` is the queue slot of the calling thread.
+void queue_rubik(const struct s_rubik& rubik, const glm::mat4& view, const glm::mat4& viewProjection,
+                 engine::RenderQueue& queue, std::size_t producer = 0) {
+  engine::EntityStore& store = *rubik.store;
+  s_turning_layer turning = find_turning_layer(rubik);
+  expose_turning_faces(rubik, turning);
+  if (rubik.batch && rubik.batch->key() != rubik.turns)
+    bake_rubik(rubik, turning);
 
-  for (int ix : indexes) {
-    rubik->cubes[ix]->rotateXYZ(rotate_point[rotate_group], negative ? -1.0f : 1.0f);
+  engine::cull_entities(store, rubik.first, rubik.count, viewProjection);
+  const engine::Shader* batchShader = nullptr;
+  for (std::uint32_t i = rubik.first; i < rubik.first + rubik.count; ++i) {
+    if (!store.meshes[i] || !(store.flags[i] & engine::ENTITY_VISIBLE))
+      continue;
+    const engine::Shader* shader = store.meshes[i]->getShader().get();
+    if (store.flags[i] & engine::ENTITY_BAKED) {
+      batchShader = shader;
+      continue;
+    }
+    float depth = -(view * glm::vec4(store.centers[i], 1.0f)).z;
+    queue.push(producer, {engine::RenderKey::make(engine::PASS_OPAQUE, shader->get(), 0, depth, i), shader,
+                          nullptr, &store.graph.world(store.nodes[i]), &store.meshCache,
+                          store.shapes[i], &store.colors[i * engine::EntityStore::kFaces],
+                          store.meshes[i]->getFaces()});
+  }
+  if (batchShader && !rubik.batch->empty()) {
+    const glm::mat4& world = store.graph.world(rubik.node);
+    float depth = -(view * world[3]).z;
+    queue.push(producer, {engine::RenderKey::make(engine::PASS_OPAQUE, batchShader->get(), 0, depth, rubik.first),
+                          batchShader, rubik.batch.get(), &world});
   }
 }
 
@@ -226,4 +590,11 @@ void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
   _scroll = true;
 }
 
+engine::InputQueue input_queue;
+
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+  input_queue.push({key, action, mods, engine::now_ns()});
+}
+
 #endif // CUBE_SRC_CALLBACKS_H_
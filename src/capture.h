@@ -0,0 +1,79 @@
+#ifndef CUBE_SRC_CAPTURE_H_
+#define CUBE_SRC_CAPTURE_H_
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+#include "engine/Jobs.h"
+#include "engine/RenderTarget.h"
+
+// Frame capture: F12 saves the next frame, --capture-every=N every Nth one,
+// as capture_<frame>.ppm without the overlay. Pixels come back through the
+// PBO ring a few frames later and are written by the job threads, so the
+// render thread neither waits for the GPU nor for the disk.
+struct s_capture {
+  engine::PixelReadback readback;
+  engine::JobCounter writing;
+  std::uint64_t every = 0; // 0 captures on request only
+  bool requested = false;
+  std::uint64_t written = 0;
+};
+
+// rows arrive bottom to top, a PPM stores them top to bottom
+void write_ppm(const char* path, const std::uint8_t* rgba, int width, int height) {
+  FILE* file = std::fopen(path, "wb");
+  if (!file) {
+    std::cerr << "ERROR::CAPTURE::CANNOT_OPEN " << path << std::endl;
+    return;
+  }
+  std::fprintf(file, "P6\n%d %d\n255\n", width, height);
+  std::vector<std::uint8_t> row((std::size_t)width * 3);
+  for (int y = height - 1; y >= 0; --y) {
+    const std::uint8_t* src = rgba + (std::size_t)y * width * 4;
+    for (int x = 0; x < width; ++x)
+      std::memcpy(&row[(std::size_t)x * 3], src + (std::size_t)x * 4, 3);
+    std::fwrite(row.data(), 1, row.size(), file);
+  }
+  std::fclose(file);
+}
+
+// queue a readback of `fbo` for `frame` when one is due; call with the
+// scene finished and before the overlay is drawn
+void capture_request(s_capture *capture, GLuint fbo, int width, int height, std::uint64_t frame) {
+  bool due = capture->requested || (capture->every && frame % capture->every == 0);
+  if (!due || width <= 0 || height <= 0)
+    return;
+  if (capture->readback.request(fbo, width, height, frame))
+    capture->requested = false;
+}
+
+// hand every frame that has come back to the job threads; a nonzero
+// `timeout_ns` waits for the ones still in flight
+void capture_collect(s_capture *capture, engine::JobSystem& jobs, GLuint64 timeout_ns = 0) {
+  capture->readback.poll([&](const std::uint8_t* rgba, int width, int height, std::uint64_t frame) {
+    std::vector<std::uint8_t> pixels(rgba, rgba + (std::size_t)width * height * 4);
+    jobs.run([pixels = std::move(pixels), width, height, frame] {
+      char path[64];
+      std::snprintf(path, sizeof(path), "capture_%06llu.ppm", (unsigned long long)frame);
+      write_ppm(path, pixels.data(), width, height);
+    }, &capture->writing);
+    capture->written++;
+  }, timeout_ns);
+}
+
+// read back the frames requested last, finish the writes and free the
+// buffers, with the context current
+void capture_release(s_capture *capture, engine::JobSystem& jobs) {
+  capture_collect(capture, jobs, 1'000'000'000);
+  jobs.wait(capture->writing);
+  capture->readback.release();
+  if (capture->written || capture->readback.dropped())
+    std::cout << "captured " << capture->written << " frame(s), " << capture->readback.dropped()
+              << " dropped" << std::endl;
+}
+
+#endif // CUBE_SRC_CAPTURE_H_
@@ -0,0 +1,404 @@
+#ifndef CUBE_SRC_ENGINE_ASSETS_H_
+#define CUBE_SRC_ENGINE_ASSETS_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <source_location>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "glad/gl.h"
+
+#include "FileWatcher.h"
+#include "Input.h"
+#include "Jobs.h"
+#include "Profiler.h"
+#include "Shader.h"
+
+namespace engine {
+// Read-only memory mapping of a whole file.
+class MappedFile {
+ protected:
+  const char* m_data = nullptr;
+  std::size_t m_size = 0;
+
+ public:
+  MappedFile() = default;
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  ~MappedFile() {
+    close();
+  }
+
+  bool open(const char* path) {
+    close();
+    int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+      return false;
+    struct stat info {};
+    bool ok = fstat(fd, &info) == 0;
+    if (ok && info.st_size > 0) {
+      void* data = mmap(nullptr, (std::size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      ok = data != MAP_FAILED;
+      if (ok) {
+        m_data = static_cast<const char*>(data);
+        m_size = (std::size_t)info.st_size;
+        madvise(data, m_size, MADV_SEQUENTIAL);
+      }
+    }
+    ::close(fd); // the mapping stays valid
+    return ok;
+  }
+
+  void close() {
+    if (m_data)
+      munmap(const_cast<char*>(m_data), m_size);
+    m_data = nullptr;
+    m_size = 0;
+  }
+
+  // fault every page in now, so whoever reads the file next does not stall
+  std::size_t prefault() const {
+    std::size_t sum = 0;
+    for (std::size_t i = 0; i < m_size; i += 4096)
+      sum += (unsigned char)m_data[i];
+    return sum;
+  }
+
+  [[nodiscard]] std::string_view view() const {
+    return {m_data, m_size};
+  }
+};
+
+// Loads assets off the GL thread. Files are memory mapped and checked by a
+// job; the finished ones go through a completion queue to the GL thread,
+// which starts compiling them in update(). With parallel shader compile the
+// driver builds the program in the background and update() only polls it,
+// so the frames meanwhile render with whatever the target held before:
+// a placeholder program, or nothing.
+class AssetLoader {
+ public:
+  // drawn while the real program loads: the same inputs, washed-out colors
+  static constexpr const char* kPlaceholderVertex = R"(#version 330 core
+layout (location = 0) in vec3 position;
+layout (location = 1) in vec3 color;
+out vec3 vColor;
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+void main() {
+    gl_Position = projection * view * model * vec4(position, 1.0);
+    vColor = color;
+}
+)";
+  static constexpr const char* kPlaceholderFragment = R"(#version 330 core
+in vec3 vColor;
+out vec4 fragColor;
+void main() {
+    fragColor = vec4(mix(vColor, vec3(0.5), 0.75), 1.0);
+}
+)";
+
+ protected:
+  enum RequestState : std::uint8_t {
+    REQUEST_DECODING = 0,
+    REQUEST_DECODED = 1,
+    REQUEST_FAILED = 2,
+    REQUEST_COMPILING = 3,
+  };
+
+  static constexpr std::size_t kNotWatched = ~(std::size_t)0;
+
+  struct s_shader_request {
+    Shader* target = nullptr;
+    std::size_t watched = kNotWatched; // entry of m_watched
+    bool reload = false;               // asked for by hot reload
+    std::shared_ptr<Shader> keep; // holds shared targets until done
+    std::string vertexPath, fragmentPath;
+    std::source_location site;
+    MappedFile vertex, fragment;
+    RequestState state = REQUEST_DECODING;
+    std::int64_t start_ns = 0;
+  };
+
+  // every shader loaded so far, so hot reload knows what a file feeds
+  struct s_watched {
+    Shader* target = nullptr;
+    std::weak_ptr<Shader> shared; // set for shared targets, which may die first
+    bool isShared = false;
+    std::string vertexPath, fragmentPath;
+    std::source_location site;
+    int vertexFile = -1, fragmentFile = -1; // FileWatcher indices
+    bool dirty = false;   // a file changed since the last request
+    bool loading = false; // a request is in flight
+  };
+
+  JobSystem& m_jobs;
+  JobCounter m_decoding;
+  std::vector<s_watched> m_watched;
+  FileWatcher m_watcher;
+  bool m_hotReload = false;
+  std::size_t m_reloaded = 0;
+  std::vector<std::unique_ptr<s_shader_request>> m_requests; // GL thread only
+
+  // decoded requests, filled by the jobs and drained by update()
+  std::mutex m_mutex;
+  std::vector<s_shader_request*> m_completed;
+  std::vector<s_shader_request*> m_drained;
+
+  std::size_t m_loaded = 0;
+  double m_lastLoadMs = 0.0;
+
+  static inline std::atomic<std::size_t> s_touched{0}; // keeps prefault() from being optimized out
+
+  static std::string_view code(const MappedFile& file) {
+    std::string_view text = file.view();
+    if (text.starts_with("\xEF\xBB\xBF"))
+      text.remove_prefix(3); // UTF-8 byte order mark
+    return text;
+  }
+
+  // on a job thread: map both files and fault them in
+  void decode(s_shader_request* request) {
+    PROFILE_ZONE("AssetLoader::decode");
+    bool ok = true;
+    if (!request->vertex.open(request->vertexPath.c_str())) {
+      std::cerr << "ERROR::ASSETS::FILE_NOT_SUCCESSFULLY_READ " << request->vertexPath << std::endl;
+      ok = false;
+    }
+    if (!request->fragment.open(request->fragmentPath.c_str())) {
+      std::cerr << "ERROR::ASSETS::FILE_NOT_SUCCESSFULLY_READ " << request->fragmentPath << std::endl;
+      ok = false;
+    }
+    if (ok && (code(request->vertex).empty() || code(request->fragment).empty())) {
+      std::cerr << "ERROR::ASSETS::EMPTY_SHADER " << request->vertexPath << std::endl;
+      ok = false;
+    }
+    if (ok)
+      s_touched.fetch_add(request->vertex.prefault() + request->fragment.prefault(), std::memory_order_relaxed);
+    request->state = ok ? REQUEST_DECODED : REQUEST_FAILED;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_completed.push_back(request);
+  }
+
+  void request(Shader* target, std::shared_ptr<Shader> keep, const char* vertexPath,
+               const char* fragmentPath, std::source_location site, std::size_t watched, bool reload) {
+    auto request = std::make_unique<s_shader_request>();
+    request->target = target;
+    request->watched = watched;
+    request->reload = reload;
+    if (watched != kNotWatched)
+      m_watched[watched].loading = true;
+    request->keep = std::move(keep);
+    request->vertexPath = vertexPath;
+    request->fragmentPath = fragmentPath;
+    request->site = site;
+    request->start_ns = now_ns();
+    s_shader_request* pending = request.get();
+    m_requests.push_back(std::move(request));
+    m_jobs.run([this, pending] { decode(pending); }, &m_decoding);
+  }
+
+  void finish(s_shader_request* request) {
+    if (request->target->finishCompile()) {
+      m_loaded++;
+      m_lastLoadMs = (double)(now_ns() - request->start_ns) / 1e6;
+      if (request->reload) {
+        m_reloaded++;
+        std::cout << "reloaded " << request->vertexPath << " + " << request->fragmentPath << " in " << m_lastLoadMs
+                  << " ms" << std::endl;
+      }
+    }
+    forget(request);
+  }
+
+  std::size_t watch(Shader* target, const std::shared_ptr<Shader>& shared, const char* vertexPath,
+                    const char* fragmentPath, std::source_location site) {
+    s_watched watched;
+    watched.target = target;
+    watched.shared = shared;
+    watched.isShared = shared != nullptr;
+    watched.vertexPath = vertexPath;
+    watched.fragmentPath = fragmentPath;
+    watched.site = site;
+    if (m_hotReload)
+      watchFiles(watched);
+    m_watched.push_back(std::move(watched));
+    return m_watched.size() - 1;
+  }
+
+  void watchFiles(s_watched& watched) {
+    if (watched.vertexFile < 0)
+      watched.vertexFile = m_watcher.add(watched.vertexPath);
+    if (watched.fragmentFile < 0)
+      watched.fragmentFile = m_watcher.add(watched.fragmentPath);
+  }
+
+  // request the programs whose files changed; one still loading is asked
+  // again once it is done, so the last save always wins
+  void reloadChanged() {
+    m_watcher.poll([this](int file) {
+      for (auto& watched : m_watched) {
+        if (watched.vertexFile == file || watched.fragmentFile == file)
+          watched.dirty = true;
+      }
+    });
+    for (std::size_t i = 0; i < m_watched.size(); ++i) {
+      s_watched& watched = m_watched[i];
+      if (!watched.dirty || watched.loading)
+        continue;
+      watched.dirty = false;
+      std::shared_ptr<Shader> keep = watched.shared.lock();
+      if (watched.isShared && !keep)
+        continue; // the shader is gone
+      request(watched.target, std::move(keep), watched.vertexPath.c_str(), watched.fragmentPath.c_str(), watched.site,
+              i, true);
+    }
+  }
+
+  void forget(s_shader_request* request) {
+    if (request->watched != kNotWatched)
+      m_watched[request->watched].loading = false;
+    for (std::size_t i = 0; i < m_requests.size(); ++i) {
+      if (m_requests[i].get() == request) {
+        m_requests.erase(m_requests.begin() + (std::ptrdiff_t)i);
+        return;
+      }
+    }
+  }
+
+ public:
+  explicit AssetLoader(JobSystem& jobs) : m_jobs(jobs) {}
+  AssetLoader(const AssetLoader&) = delete;
+  AssetLoader& operator=(const AssetLoader&) = delete;
+
+  ~AssetLoader() {
+    m_jobs.wait(m_decoding);
+  }
+
+  // A shader that can be drawn with right away: it holds the placeholder
+  // program until the real one is built.
+  std::shared_ptr<Shader> loadShader(const char* vertexPath, const char* fragmentPath,
+                                     std::source_location site = std::source_location::current()) {
+    auto shader = std::make_shared<Shader>();
+    shader->setName(std::string(vertexPath) + " (placeholder)");
+    shader->beginCompile(kPlaceholderVertex, kPlaceholderFragment, site);
+    shader->finishCompile();
+    shader->setName(vertexPath);
+    request(shader.get(), shader, vertexPath, fragmentPath, site, watch(shader.get(), shader, vertexPath, fragmentPath, site),
+            false);
+    return shader;
+  }
+
+  // Load into an existing shader, which keeps its current program (maybe
+  // none) until then; it must outlive the loader or its release().
+  void loadShader(Shader& target, const char* vertexPath, const char* fragmentPath,
+                  std::source_location site = std::source_location::current()) {
+    target.setName(vertexPath);
+    request(&target, nullptr, vertexPath, fragmentPath, site, watch(&target, nullptr, vertexPath, fragmentPath, site),
+            false);
+  }
+
+  // Watch the files of every shader loaded so far and from now on; when one
+  // is written, the programs built from it are reloaded in the background and
+  // swapped in by update(). A program that fails to build is not swapped in.
+  void enableHotReload() {
+    if (m_hotReload)
+      return;
+    m_hotReload = true;
+    for (auto& watched : m_watched)
+      watchFiles(watched);
+  }
+
+  // GL thread, once per frame: start compiling what was decoded and swap in
+  // the programs the driver has finished
+  void update() {
+    if (m_hotReload)
+      reloadChanged();
+    if (m_requests.empty())
+      return;
+    PROFILE_ZONE("AssetLoader::update");
+    if (m_jobs.threads() == 1)
+      m_jobs.wait(m_decoding); // no workers, decode here
+
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_drained.swap(m_completed);
+    }
+    for (s_shader_request* request : m_drained) {
+      if (request->state == REQUEST_FAILED) {
+        forget(request);
+        continue;
+      }
+      request->target->beginCompile(code(request->vertex), code(request->fragment), request->site);
+      request->state = REQUEST_COMPILING;
+      request->vertex.close(); // the driver has its own copy now
+      request->fragment.close();
+    }
+    m_drained.clear();
+
+    for (std::size_t i = m_requests.size(); i-- > 0;) {
+      s_shader_request* request = m_requests[i].get();
+      if (request->state == REQUEST_COMPILING && request->target->compileReady())
+        finish(request);
+    }
+  }
+
+  // block until everything requested so far is in place
+  void finishAll() {
+    m_jobs.wait(m_decoding);
+    while (!m_requests.empty()) {
+      update();
+      for (std::size_t i = m_requests.size(); i-- > 0;) {
+        if (m_requests[i]->state == REQUEST_COMPILING)
+          finish(m_requests[i].get());
+      }
+    }
+  }
+
+  // drop what is still loading, must run while the context is still current
+  void release() {
+    m_jobs.wait(m_decoding);
+    for (auto& request : m_requests)
+      request->target->discardCompile();
+    m_requests.clear();
+    m_completed.clear();
+    m_watched.clear();
+    m_hotReload = false;
+  }
+
+  // programs swapped in by hot reload
+  [[nodiscard]] std::size_t reloaded() const {
+    return m_reloaded;
+  }
+
+  // requests still decoding or compiling
+  [[nodiscard]] std::size_t pending() const {
+    return m_requests.size();
+  }
+
+  [[nodiscard]] std::size_t loaded() const {
+    return m_loaded;
+  }
+
+  // request to swap-in time of the last asset
+  [[nodiscard]] double lastLoadMs() const {
+    return m_lastLoadMs;
+  }
+};
+}
+
+#endif // CUBE_SRC_ENGINE_ASSETS_H_
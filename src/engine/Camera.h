@@ -18,12 +18,8 @@ namespace engine {
   public:
     Camera() = default;
 
-    [[nodiscard]] Camera& copy() {
-      auto* c = new Camera();
-      c->m_model = glm::mat4{m_model};
-      c->m_view = glm::mat4{m_model};
-      c->m_projection = glm::mat4{m_model};
-      return *c;
+    [[nodiscard]] Camera copy() const {
+      return *this;
     }
 
     void rotate(const glm::vec3& axis, float angle) {
@@ -72,9 +68,21 @@ namespace engine {
       return {m_model[0][0], m_model[1][1], m_model[2][2]};
     }
 
-    [[nodiscard]] glm::mat4 getView() {
+    [[nodiscard]] const glm::mat4& getView() const {
       return m_view;
     }
+
+    [[nodiscard]] const glm::mat4& getProjection() const {
+      return m_projection;
+    }
+
+    [[nodiscard]] const glm::mat4& getModel() const {
+      return m_model;
+    }
+
+    void setModel(const glm::mat4& model) {
+      m_model = model;
+    }
   };
 }
 
@@ -0,0 +1,82 @@
+#ifndef CUBE_SRC_ENGINE_DYNAMICRESOLUTION_H_
+#define CUBE_SRC_ENGINE_DYNAMICRESOLUTION_H_
+
+#include <algorithm>
+#include <cmath>
+
+namespace engine {
+// Picks the scale of the scene's render target from the measured cost of
+// the frame. Frame times are averaged over a window of kWindow frames;
+// a window over budget shrinks the target about as much as its area is
+// over, a window under kRaise of the budget grows it by one step, and
+// anything in between keeps the scale. The window after a change is
+// skipped, it still measures the old size. Scales move in steps of
+// kStep, so the target is only reallocated on real changes.
+class DynamicResolution {
+ public:
+  static constexpr int kWindow = 30;
+  static constexpr float kStep = 0.05f;
+  static constexpr float kRaise = 0.75f;
+
+ protected:
+  float m_min = 0.5f, m_max = 1.0f;
+  float m_budget = 1000.0f / 60.0f;
+  float m_scale = 1.0f;
+  float m_sum = 0.0f;
+  int m_frames = 0;
+  bool m_settling = false;
+
+  [[nodiscard]] float quantize(float scale) const {
+    return std::clamp(std::round(scale / kStep) * kStep, m_min, m_max);
+  }
+
+ public:
+  // `budget_ms` is the frame time to hold, the scale stays in [min, max]
+  void configure(float min, float max, float budget_ms) {
+    m_min = min;
+    m_max = max;
+    m_budget = budget_ms;
+    m_scale = max;
+    m_sum = 0.0f;
+    m_frames = 0;
+  }
+
+  // add the cost of a finished frame, returns true when the scale changed
+  bool update(float frame_ms) {
+    m_sum += frame_ms;
+    if (++m_frames < kWindow)
+      return false;
+    float mean = m_sum / (float)m_frames;
+    m_sum = 0.0f;
+    m_frames = 0;
+    if (m_settling) {
+      m_settling = false;
+      return false;
+    }
+
+    float scale = m_scale;
+    if (mean > m_budget)
+      // the cost follows the pixel count, the square of the scale
+      scale = std::min(quantize(m_scale * std::sqrt(m_budget / mean)), m_scale - kStep);
+    else if (mean < m_budget * kRaise)
+      scale = m_scale + kStep;
+    scale = std::clamp(scale, m_min, m_max);
+    if (std::abs(scale - m_scale) < kStep * 0.5f)
+      return false;
+    m_scale = scale;
+    m_settling = true;
+    return true;
+  }
+
+  [[nodiscard]] float scale() const {
+    return m_scale;
+  }
+
+  // `size` of the window in target pixels, at least one
+  [[nodiscard]] int scaled(int size) const {
+    return std::max(1, (int)std::lround((float)size * m_scale));
+  }
+};
+}
+
+#endif // CUBE_SRC_ENGINE_DYNAMICRESOLUTION_H_
@@ -0,0 +1,181 @@
+#ifndef CUBE_SRC_ENGINE_ENTITYSTORE_H_
+#define CUBE_SRC_ENGINE_ENTITYSTORE_H_
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "glm/glm.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+
+#include "Memory.h"
+#include "MeshCache.h"
+#include "SceneGraph.h"
+#include "primitives/RubikAtomCube.h"
+
+namespace engine {
+enum EntityFlags : std::uint8_t {
+  ENTITY_VISIBLE = 1 << 0, // passed the last cull
+  ENTITY_BAKED = 1 << 1,   // drawn as part of a StaticBatch
+};
+
+// Structure-of-arrays storage for box entities (the cubies). An entity is an
+// index; each column holds one attribute for every entity, so the systems
+// below walk plain contiguous arrays instead of chasing one heap object per
+// cubie. Every entity is a node of `graph`, whose world matrix places it.
+// Stores that are drawn give each entity a mesh: boxes of the same size
+// share one box of `meshCache`, kept around the origin, drawn with that
+// matrix and colored per face from `colors`; the entity's RubikAtomCube
+// keeps its faces, camera and program and has no GL buffers of its own.
+// release() frees the cache's buffers while the context is still current.
+class EntityStore {
+ public:
+  static constexpr std::size_t kFaces = 6;
+
+  SceneGraph graph;
+  std::vector<std::uint32_t> nodes; // scene graph node of each entity
+  std::vector<glm::vec3> centers;   // world space, as of the last update
+  std::vector<glm::vec3> extents;   // half the box dimensions
+  std::vector<float> radii;         // world space bounding sphere around the center
+  std::vector<glm::vec3> colors;    // kFaces per entity
+  std::vector<std::uint8_t> faces;  // CubeFace mask of the faces that can always be seen
+  std::vector<primitives::RubikAtomCube*> meshes; // null when not drawn
+  std::vector<std::uint32_t> shapes;                // meshCache id of the box, when drawn
+  std::vector<std::uint8_t> flags;
+  Pool<primitives::RubikAtomCube> meshPool; // slots of `meshes`
+  MeshCache meshCache;
+
+  EntityStore() = default;
+  EntityStore(const EntityStore&) = delete;
+  EntityStore& operator=(const EntityStore&) = delete;
+
+  ~EntityStore() {
+    release();
+  }
+
+  [[nodiscard]] std::size_t size() const {
+    return nodes.size();
+  }
+
+  // add a box centered at `center` in the space of `parent`, returns its
+  // entity index; only the faces in `visibleFaces` are drawn
+  std::uint32_t create(std::uint32_t parent, const glm::vec3& center, const glm::vec3& dimensions,
+                       const std::array<glm::vec3, kFaces>& faceColors, std::uint8_t visibleFaces = 0x3F) {
+    auto id = (std::uint32_t)size();
+    nodes.push_back(graph.create(parent, glm::translate(glm::mat4(1.0f), center), id));
+    centers.push_back(center);
+    extents.push_back(dimensions / 2.0f);
+    radii.push_back(glm::length(dimensions / 2.0f));
+    colors.insert(colors.end(), faceColors.begin(), faceColors.end());
+    faces.push_back(visibleFaces);
+    meshes.push_back(nullptr);
+    shapes.push_back(0);
+    flags.push_back(ENTITY_VISIBLE);
+    return id;
+  }
+
+  // create the mesh of an entity and find its box in the cache, sharing
+  // `shader` with the others
+  void attachMesh(std::uint32_t id, const std::shared_ptr<Shader>& shader, const Camera& camera) {
+    auto* mesh = meshPool.create(glm::vec3(0.0f), extents[id] * 2.0f);
+    mesh->setCamera(camera);
+    mesh->setShader(shader);
+    mesh->setColors({colors.begin() + id * kFaces, colors.begin() + (id + 1) * kFaces});
+    mesh->setFaces(faces[id]);
+    meshes[id] = mesh;
+    shapes[id] = meshCache.get(primitives::box(extents[id] * 2.0f));
+  }
+
+  // drop every entity from `count` on, freeing their nodes and meshes
+  void truncate(std::size_t count) {
+    if (count >= size())
+      return;
+    for (std::size_t i = count; i < size(); ++i) {
+      graph.destroy(nodes[i]);
+      meshPool.destroy(meshes[i]);
+    }
+    nodes.resize(count);
+    centers.resize(count);
+    extents.resize(count);
+    radii.resize(count);
+    colors.resize(count * kFaces);
+    faces.resize(count);
+    meshes.resize(count);
+    shapes.resize(count);
+    flags.resize(count);
+  }
+
+  // free the meshes, must run while the context is still current
+  void release() {
+    truncate(0);
+    meshCache.release();
+  }
+};
+
+// Set the local matrices of `count` entities starting at `first`; unchanged
+// ones are not marked dirty.
+inline void set_transforms(EntityStore& store, std::size_t first, std::size_t count, const glm::mat4* source) {
+  for (std::size_t id = first; id < first + count; ++id)
+    store.graph.setLocal(store.nodes[id], source[id - first]);
+}
+
+// Update the scene graph and refresh the bounds of the entities it moved.
+// Returns the number of nodes updated.
+inline std::size_t update_entities(EntityStore& store) {
+  std::size_t updated = store.graph.update();
+  for (std::uint32_t node : store.graph.updated()) {
+    std::uint32_t id = store.graph.payload(node);
+    if (id == SceneGraph::kNone)
+      continue; // puzzle or pivot node
+    const glm::mat4& world = store.graph.world(node);
+    // the world matrix may scale, so radii grow with its longest axis
+    float scale = std::sqrt(std::max({glm::dot(glm::vec3(world[0]), glm::vec3(world[0])),
+                                      glm::dot(glm::vec3(world[1]), glm::vec3(world[1])),
+                                      glm::dot(glm::vec3(world[2]), glm::vec3(world[2]))}));
+    store.centers[id] = glm::vec3(world[3]);
+    store.radii[id] = glm::length(store.extents[id]) * scale;
+  }
+  return updated;
+}
+
+// Frustum test of the bounding spheres of entities [first, first + count);
+// sets or clears ENTITY_VISIBLE and returns the visible count.
+inline std::size_t cull_entities(EntityStore& store, std::size_t first, std::size_t count,
+                                 const glm::mat4& viewProjection) {
+  // world space planes from the rows of the view-projection matrix
+  const glm::mat4& m = viewProjection;
+  glm::vec4 rows[4] = {
+      {m[0][0], m[1][0], m[2][0], m[3][0]},
+      {m[0][1], m[1][1], m[2][1], m[3][1]},
+      {m[0][2], m[1][2], m[2][2], m[3][2]},
+      {m[0][3], m[1][3], m[2][3], m[3][3]},
+  };
+  glm::vec4 planes[6] = {
+      rows[3] + rows[0], rows[3] - rows[0], rows[3] + rows[1],
+      rows[3] - rows[1], rows[3] + rows[2], rows[3] - rows[2],
+  };
+  for (auto& plane : planes)
+    plane /= glm::length(glm::vec3(plane));
+
+  std::size_t visible = 0;
+  for (std::size_t id = first; id < first + count; ++id) {
+    glm::vec4 center(store.centers[id], 1.0f);
+    float radius = store.radii[id];
+    bool inside = true;
+    for (const auto& plane : planes) {
+      if (glm::dot(plane, center) < -radius) {
+        inside = false;
+        break;
+      }
+    }
+    store.flags[id] = inside ? store.flags[id] | ENTITY_VISIBLE : store.flags[id] & ~ENTITY_VISIBLE;
+    visible += inside;
+  }
+  return visible;
+}
+}
+
+#endif // CUBE_SRC_ENGINE_ENTITYSTORE_H_
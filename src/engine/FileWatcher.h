@@ -0,0 +1,86 @@
+#ifndef CUBE_SRC_ENGINE_FILEWATCHER_H_
+#define CUBE_SRC_ENGINE_FILEWATCHER_H_
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace engine {
+// Reports files that were rewritten, through inotify on their directories
+// (editors often save by renaming a new file over the old one, which a watch
+// on the file itself would lose). poll() never blocks.
+class FileWatcher {
+ protected:
+  struct s_file {
+    int wd;
+    std::string name; // inside the watched directory
+  };
+
+  int m_fd = -1;
+  std::vector<s_file> m_files;
+
+ public:
+  FileWatcher() = default;
+  FileWatcher(const FileWatcher&) = delete;
+  FileWatcher& operator=(const FileWatcher&) = delete;
+
+  ~FileWatcher() {
+    if (m_fd >= 0)
+      close(m_fd);
+  }
+
+  // start watching `path`; returns the index poll() reports it by, or -1
+  int add(const std::string& path) {
+    if (m_fd < 0) {
+      m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+      if (m_fd < 0) {
+        std::cerr << "ERROR::FILE_WATCHER::INIT_FAILED " << std::strerror(errno) << std::endl;
+        return -1;
+      }
+    }
+    std::size_t slash = path.find_last_of('/');
+    std::string dir = slash == std::string::npos ? "." : path.substr(0, slash);
+    std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+    int wd = inotify_add_watch(m_fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (wd < 0) {
+      std::cerr << "ERROR::FILE_WATCHER::WATCH_FAILED " << dir << ": " << std::strerror(errno) << std::endl;
+      return -1;
+    }
+    m_files.push_back({wd, std::move(name)});
+    return (int)m_files.size() - 1;
+  }
+
+  // call changed(index) for every watched file written since the last poll;
+  // a file saved several times is reported as often
+  template <typename F>
+  void poll(F&& changed) {
+    if (m_fd < 0)
+      return;
+    alignas(inotify_event) char buffer[4096];
+    for (;;) {
+      ssize_t length = read(m_fd, buffer, sizeof(buffer));
+      if (length <= 0)
+        return; // EAGAIN: nothing more
+      for (ssize_t offset = 0; offset < length;) {
+        const auto* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+        offset += (ssize_t)(sizeof(inotify_event) + event->len);
+        if (!event->len)
+          continue;
+        std::string_view name(event->name);
+        for (std::size_t i = 0; i < m_files.size(); ++i) {
+          if (m_files[i].wd == event->wd && m_files[i].name == name)
+            changed((int)i);
+        }
+      }
+    }
+  }
+};
+}
+
+#endif // CUBE_SRC_ENGINE_FILEWATCHER_H_
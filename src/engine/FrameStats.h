@@ -0,0 +1,90 @@
+#ifndef CUBE_SRC_ENGINE_FRAMESTATS_H_
+#define CUBE_SRC_ENGINE_FRAMESTATS_H_
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "Memory.h"
+
+namespace engine {
+// GL work the engine issued during one frame, counted on the render thread
+struct s_frame_counters {
+  std::uint64_t draw_calls = 0;
+  std::uint64_t gl_calls_elided = 0; // redundant state changes skipped
+  std::uint64_t bytes_uploaded = 0;
+  std::uint64_t heap_allocations = 0; // global operator new calls on the render thread
+};
+
+class FrameStats {
+ protected:
+  static inline s_frame_counters s_current;
+  static inline s_frame_counters s_last;
+  static inline std::uint64_t s_heapMark = 0;
+
+ public:
+  static s_frame_counters& current() {
+    return s_current;
+  }
+
+  // counters of the last finished frame
+  static const s_frame_counters& last() {
+    return s_last;
+  }
+
+  static void endFrame() {
+    std::uint64_t heap = HeapStats::threadAllocations();
+    s_current.heap_allocations = heap - s_heapMark;
+    s_heapMark = heap;
+    s_last = s_current;
+    s_current = {};
+  }
+};
+
+// Frame times of the last kCapacity frames, in milliseconds.
+class FrameTimeHistory {
+ public:
+  static constexpr std::size_t kCapacity = 256;
+
+ protected:
+  std::array<float, kCapacity> m_times{};
+  std::size_t m_count = 0;
+
+ public:
+  void add(float ms) {
+    m_times[m_count % kCapacity] = ms;
+    m_count++;
+  }
+
+  [[nodiscard]] std::size_t size() const {
+    return std::min(m_count, kCapacity);
+  }
+
+  // i-th most recent frame, 0 is the newest
+  [[nodiscard]] float recent(std::size_t i) const {
+    return i < size() ? m_times[(m_count - 1 - i) % kCapacity] : 0.0f;
+  }
+
+  [[nodiscard]] float percentile(float p) const {
+    std::size_t n = size();
+    if (!n)
+      return 0.0f;
+    std::array<float, kCapacity> sorted = m_times;
+    auto rank = (std::size_t)(p / 100.0f * (float)(n - 1));
+    std::nth_element(sorted.begin(), sorted.begin() + (std::ptrdiff_t)rank,
+                     sorted.begin() + (std::ptrdiff_t)n);
+    return sorted[rank];
+  }
+
+  [[nodiscard]] float mean() const {
+    std::size_t n = size();
+    float sum = 0.0f;
+    for (std::size_t i = 0; i < n; ++i)
+      sum += m_times[i];
+    return n ? sum / (float)n : 0.0f;
+  }
+};
+}
+
+#endif // CUBE_SRC_ENGINE_FRAMESTATS_H_
@@ -0,0 +1,208 @@
+#ifndef CUBE_SRC_ENGINE_GLREGISTRY_H_
+#define CUBE_SRC_ENGINE_GLREGISTRY_H_
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <source_location>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "glad/gl.h"
+
+#include "GLTrace.h"
+
+namespace engine {
+struct s_gl_resource {
+  GLObjectType type = OBJ_BUFFER;
+  GLuint id = 0;
+  std::size_t bytes = 0; // estimated GPU memory, buffers and textures only
+  std::string owner;
+  std::source_location site;
+};
+
+// Registry of every live GL object the engine created. Objects are made and
+// freed through create()/destroy() (or track()/untrack() for programs and
+// shader stages), so live counts and memory estimates can be reported at any
+// time and whatever is still alive at shutdown is listed as a leak with the
+// place it was created.
+class GLRegistry {
+ protected:
+  static inline std::mutex s_mutex;
+  static inline std::unordered_map<std::uint64_t, s_gl_resource> s_live;
+  static inline std::array<std::uint64_t, OBJ_COUNT> s_created{};
+  // totals readable from any thread without taking the mutex
+  static inline std::atomic<std::size_t> s_liveCount{0};
+  static inline std::atomic<std::size_t> s_liveBytes{0};
+
+  static std::uint64_t key(GLObjectType type, GLuint id) {
+    return (std::uint64_t)type << 32 | id;
+  }
+
+ public:
+  // generate one object of a type that has a glGen* entry point
+  static GLuint create(GLObjectType type, const char* owner,
+                       std::source_location site = std::source_location::current()) {
+    GLuint id = 0;
+    switch (type) {
+      case OBJ_BUFFER:
+        glGenBuffers(1, &id);
+        break;
+      case OBJ_VERTEX_ARRAY:
+        glGenVertexArrays(1, &id);
+        break;
+      case OBJ_TEXTURE:
+        glGenTextures(1, &id);
+        break;
+      case OBJ_QUERY:
+        glGenQueries(1, &id);
+        break;
+      case OBJ_FRAMEBUFFER:
+        glGenFramebuffers(1, &id);
+        break;
+      default:
+        std::cerr << "ERROR::GL_REGISTRY::NOT_GENERATED " << kGLObjectNames[type] << std::endl;
+        return 0;
+    }
+    track(type, id, owner, site);
+    return id;
+  }
+
+  // delete an object made by create() or track() and zero the handle
+  static void destroy(GLObjectType type, GLuint& id) {
+    if (!id)
+      return;
+    switch (type) {
+      case OBJ_BUFFER:
+        glDeleteBuffers(1, &id);
+        break;
+      case OBJ_VERTEX_ARRAY:
+        glDeleteVertexArrays(1, &id);
+        break;
+      case OBJ_TEXTURE:
+        glDeleteTextures(1, &id);
+        break;
+      case OBJ_QUERY:
+        glDeleteQueries(1, &id);
+        break;
+      case OBJ_FRAMEBUFFER:
+        glDeleteFramebuffers(1, &id);
+        break;
+      case OBJ_PROGRAM:
+        glDeleteProgram(id);
+        break;
+      case OBJ_SHADER:
+        glDeleteShader(id);
+        break;
+      default:
+        break;
+    }
+    untrack(type, id);
+    id = 0;
+  }
+
+  // register an object created outside create(), e.g. by glCreateProgram
+  static void track(GLObjectType type, GLuint id, const char* owner,
+                    std::source_location site = std::source_location::current()) {
+    if (!id)
+      return;
+    std::lock_guard<std::mutex> lock(s_mutex);
+    auto [it, added] = s_live.try_emplace(key(type, id));
+    if (!added)
+      s_liveBytes.fetch_sub(it->second.bytes, std::memory_order_relaxed);
+    it->second = {type, id, 0, owner ? owner : "", site};
+    s_created[type]++;
+    s_liveCount.store(s_live.size(), std::memory_order_relaxed);
+  }
+
+  static void untrack(GLObjectType type, GLuint id) {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    auto it = s_live.find(key(type, id));
+    if (it == s_live.end())
+      return;
+    s_liveBytes.fetch_sub(it->second.bytes, std::memory_order_relaxed);
+    s_live.erase(it);
+    s_liveCount.store(s_live.size(), std::memory_order_relaxed);
+  }
+
+  // record the storage size after glBufferData/glTexImage*
+  static void setBytes(GLObjectType type, GLuint id, std::size_t bytes) {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    auto it = s_live.find(key(type, id));
+    if (it == s_live.end())
+      return;
+    s_liveBytes.fetch_add(bytes - it->second.bytes, std::memory_order_relaxed);
+    it->second.bytes = bytes;
+  }
+
+  [[nodiscard]] static std::size_t live(GLObjectType type) {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    return (std::size_t)std::count_if(s_live.begin(), s_live.end(),
+                                      [type](const auto& entry) { return entry.second.type == type; });
+  }
+
+  [[nodiscard]] static std::size_t liveTotal() {
+    return s_liveCount.load(std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] static std::size_t bytes() {
+    return s_liveBytes.load(std::memory_order_relaxed);
+  }
+
+  // live objects and estimated memory per type and per owner
+  static void report(std::ostream& out) {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    std::array<std::size_t, OBJ_COUNT> count{}, size{};
+    std::vector<std::pair<std::string, std::size_t>> owners;
+    std::size_t total = 0;
+    for (const auto& [k, res] : s_live) {
+      count[res.type]++;
+      size[res.type] += res.bytes;
+      total += res.bytes;
+      auto it = std::find_if(owners.begin(), owners.end(), [&](const auto& o) { return o.first == res.owner; });
+      if (it == owners.end())
+        owners.emplace_back(res.owner, res.bytes);
+      else
+        it->second += res.bytes;
+    }
+    std::sort(owners.begin(), owners.end(), [](const auto& a, const auto& b) { return a.second > b.second; });
+
+    out << "GL resources: " << s_live.size() << " live, " << (double)total / 1024.0 << " KB estimated\n";
+    for (int t = 0; t < OBJ_COUNT; ++t)
+      out << "  " << std::setw(14) << std::left << kGLObjectNames[t] << std::right << std::setw(6)
+          << count[t] << " live" << std::setw(8) << s_created[t] << " created" << std::setw(12)
+          << size[t] << " bytes\n";
+    for (const auto& [owner, ownerBytes] : owners)
+      out << "  owner " << owner << ": " << ownerBytes << " bytes\n";
+    out << std::flush;
+  }
+
+  // list every object still alive, call right before the context goes away;
+  // returns the number of leaked objects
+  static std::size_t reportLeaks(std::ostream& out) {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    if (s_live.empty())
+      return 0;
+    std::vector<const s_gl_resource*> leaks;
+    for (const auto& entry : s_live)
+      leaks.push_back(&entry.second);
+    std::sort(leaks.begin(), leaks.end(), [](const s_gl_resource* a, const s_gl_resource* b) {
+      return a->type != b->type ? a->type < b->type : a->id < b->id;
+    });
+    out << "GL_REGISTRY::LEAKS " << leaks.size() << " object(s) still alive\n";
+    for (const s_gl_resource* res : leaks)
+      out << "  " << kGLObjectNames[res->type] << ' ' << res->id << ", " << res->bytes << " bytes, owner "
+          << res->owner << ", created at " << res->site.file_name() << ':' << res->site.line() << " ("
+          << res->site.function_name() << ")\n";
+    out << std::flush;
+    return leaks.size();
+  }
+};
+}
+
+#endif // CUBE_SRC_ENGINE_GLREGISTRY_H_
@@ -0,0 +1,231 @@
+#ifndef CUBE_SRC_ENGINE_GLTRACE_H_
+#define CUBE_SRC_ENGINE_GLTRACE_H_
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "glad/gl.h"
+
+// Entry points wrapped by GLTrace:
+//   X(name, return type, (parameters), (arguments), accounting statement)
+// `name` stringifies to the GL name and expands to glad's function pointer.
+#define CUBE_GL_TRACE_FUNCS(X) \
+  X(glDrawArrays, void, (GLenum mode, GLint first, GLsizei count), (mode, first, count), ) \
+  X(glDrawElements, void, (GLenum mode, GLsizei count, GLenum type, const void* indices), \
+    (mode, count, type, indices), ) \
+  X(glDrawArraysInstanced, void, (GLenum mode, GLint first, GLsizei count, GLsizei instances), \
+    (mode, first, count, instances), ) \
+  X(glDrawElementsInstanced, void, \
+    (GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei instances), \
+    (mode, count, type, indices, instances), ) \
+  X(glClear, void, (GLbitfield mask), (mask), ) \
+  X(glEnable, void, (GLenum cap), (cap), ) \
+  X(glDisable, void, (GLenum cap), (cap), ) \
+  X(glUseProgram, void, (GLuint program), (program), ) \
+  X(glBindVertexArray, void, (GLuint array), (array), ) \
+  X(glBindBuffer, void, (GLenum target, GLuint buffer), (target, buffer), ) \
+  X(glBindTexture, void, (GLenum target, GLuint texture), (target, texture), ) \
+  X(glBindFramebuffer, void, (GLenum target, GLuint framebuffer), (target, framebuffer), ) \
+  X(glBufferData, void, (GLenum target, GLsizeiptr size, const void* data, GLenum usage), \
+    (target, size, data, usage), s_current.buffer_bytes += (std::uint64_t)size) \
+  X(glBufferSubData, void, (GLenum target, GLintptr offset, GLsizeiptr size, const void* data), \
+    (target, offset, size, data), s_current.buffer_bytes += (std::uint64_t)size) \
+  X(glTexImage2D, void, \
+    (GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, \
+     GLint border, GLenum format, GLenum type, const void* pixels), \
+    (target, level, internalformat, width, height, border, format, type, pixels), ) \
+  X(glVertexAttribPointer, void, \
+    (GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer), \
+    (index, size, type, normalized, stride, pointer), ) \
+  X(glEnableVertexAttribArray, void, (GLuint index), (index), ) \
+  X(glGetUniformLocation, GLint, (GLuint program, const GLchar* name), (program, name), ) \
+  X(glUniform1i, void, (GLint location, GLint v0), (location, v0), ) \
+  X(glUniform1f, void, (GLint location, GLfloat v0), (location, v0), ) \
+  X(glUniform2f, void, (GLint location, GLfloat v0, GLfloat v1), (location, v0, v1), ) \
+  X(glUniform3fv, void, (GLint location, GLsizei count, const GLfloat* value), \
+    (location, count, value), ) \
+  X(glUniform4fv, void, (GLint location, GLsizei count, const GLfloat* value), \
+    (location, count, value), ) \
+  X(glUniformMatrix4fv, void, \
+    (GLint location, GLsizei count, GLboolean transpose, const GLfloat* value), \
+    (location, count, transpose, value), ) \
+  X(glGenBuffers, void, (GLsizei n, GLuint* ids), (n, ids), created(OBJ_BUFFER, n)) \
+  X(glDeleteBuffers, void, (GLsizei n, const GLuint* ids), (n, ids), deleted(OBJ_BUFFER, n, ids)) \
+  X(glGenVertexArrays, void, (GLsizei n, GLuint* ids), (n, ids), created(OBJ_VERTEX_ARRAY, n)) \
+  X(glDeleteVertexArrays, void, (GLsizei n, const GLuint* ids), (n, ids), \
+    deleted(OBJ_VERTEX_ARRAY, n, ids)) \
+  X(glGenTextures, void, (GLsizei n, GLuint* ids), (n, ids), created(OBJ_TEXTURE, n)) \
+  X(glDeleteTextures, void, (GLsizei n, const GLuint* ids), (n, ids), deleted(OBJ_TEXTURE, n, ids)) \
+  X(glGenQueries, void, (GLsizei n, GLuint* ids), (n, ids), created(OBJ_QUERY, n)) \
+  X(glDeleteQueries, void, (GLsizei n, const GLuint* ids), (n, ids), deleted(OBJ_QUERY, n, ids)) \
+  X(glGenFramebuffers, void, (GLsizei n, GLuint* ids), (n, ids), created(OBJ_FRAMEBUFFER, n)) \
+  X(glDeleteFramebuffers, void, (GLsizei n, const GLuint* ids), (n, ids), \
+    deleted(OBJ_FRAMEBUFFER, n, ids)) \
+  X(glCreateProgram, GLuint, (), (), created(OBJ_PROGRAM, 1)) \
+  X(glDeleteProgram, void, (GLuint id), (id), deleted(OBJ_PROGRAM, 1, &id)) \
+  X(glCreateShader, GLuint, (GLenum type), (type), created(OBJ_SHADER, 1)) \
+  X(glDeleteShader, void, (GLuint id), (id), deleted(OBJ_SHADER, 1, &id))
+
+namespace engine {
+enum GLObjectType {
+  OBJ_BUFFER,
+  OBJ_VERTEX_ARRAY,
+  OBJ_TEXTURE,
+  OBJ_QUERY,
+  OBJ_FRAMEBUFFER,
+  OBJ_PROGRAM,
+  OBJ_SHADER,
+  OBJ_COUNT,
+};
+
+constexpr const char* kGLObjectNames[OBJ_COUNT] = {
+    "buffer", "vertex array", "texture", "query", "framebuffer", "program", "shader",
+};
+
+enum GLTraceCall {
+#define CUBE_GL_TRACE_ENUM(name, ret, params, args, hook) CALL_##name,
+  CUBE_GL_TRACE_FUNCS(CUBE_GL_TRACE_ENUM)
+#undef CUBE_GL_TRACE_ENUM
+  CALL_COUNT
+};
+
+struct s_gl_counters {
+  std::array<std::uint64_t, CALL_COUNT> calls{};
+  std::uint64_t buffer_bytes = 0; // passed to glBufferData/glBufferSubData
+  std::array<std::uint64_t, OBJ_COUNT> created{};
+  std::array<std::uint64_t, OBJ_COUNT> deleted{};
+
+  [[nodiscard]] std::uint64_t totalCalls() const {
+    std::uint64_t total = 0;
+    for (auto n : calls)
+      total += n;
+    return total;
+  }
+};
+
+// Optional GL call interposer. install() hands glad a loader that returns
+// counting wrappers for the entry points above, so the engine code and the
+// generated loader stay untouched and a run without it pays nothing.
+// Counters are per frame and only touched by the thread owning the context.
+class GLTrace {
+ protected:
+  static inline GLADloadfunc s_load = nullptr;
+  static inline bool s_installed = false;
+  static inline s_gl_counters s_current;
+  static inline s_gl_counters s_last;
+  static inline std::array<std::int64_t, OBJ_COUNT> s_live{};
+
+  static void created(GLObjectType type, GLsizei n) {
+    s_current.created[type] += (std::uint64_t)n;
+    s_live[type] += n;
+  }
+
+  static void deleted(GLObjectType type, GLsizei n, const GLuint* ids) {
+    // deleting the name 0 is a no-op in GL and is not counted
+    for (GLsizei i = 0; i < n; ++i) {
+      if (ids[i]) {
+        s_current.deleted[type]++;
+        s_live[type]--;
+      }
+    }
+  }
+
+#define CUBE_GL_TRACE_WRAP(name, ret, params, args, hook) \
+  static inline decltype(name) s_real_##name = nullptr; \
+  static ret GLAD_API_PTR wrap_##name params { \
+    s_current.calls[CALL_##name]++; \
+    hook; \
+    return s_real_##name args; \
+  }
+  CUBE_GL_TRACE_FUNCS(CUBE_GL_TRACE_WRAP)
+#undef CUBE_GL_TRACE_WRAP
+
+  static GLADapiproc load(const char* name) {
+    GLADapiproc real = s_load(name);
+    if (!real)
+      return real;
+#define CUBE_GL_TRACE_LOAD(fn, ret, params, args, hook) \
+    if (std::strcmp(name, #fn) == 0) { \
+      s_real_##fn = reinterpret_cast<decltype(s_real_##fn)>(real); \
+      return reinterpret_cast<GLADapiproc>(&wrap_##fn); \
+    }
+    CUBE_GL_TRACE_FUNCS(CUBE_GL_TRACE_LOAD)
+#undef CUBE_GL_TRACE_LOAD
+    return real;
+  }
+
+ public:
+  static constexpr const char* kCallNames[CALL_COUNT] = {
+#define CUBE_GL_TRACE_NAME(name, ret, params, args, hook) #name,
+      CUBE_GL_TRACE_FUNCS(CUBE_GL_TRACE_NAME)
+#undef CUBE_GL_TRACE_NAME
+  };
+
+  // use instead of gladLoadGL(load) to load GL with the wrappers in place
+  static int install(GLADloadfunc load) {
+    s_load = load;
+    s_installed = true;
+    return gladLoadGL(&GLTrace::load);
+  }
+
+  [[nodiscard]] static bool installed() {
+    return s_installed;
+  }
+
+  static void endFrame() {
+    s_last = s_current;
+    s_current = {};
+  }
+
+  // counters of the last finished frame
+  [[nodiscard]] static const s_gl_counters& last() {
+    return s_last;
+  }
+
+  // objects created minus deleted since install()
+  [[nodiscard]] static std::int64_t live(GLObjectType type) {
+    return s_live[type];
+  }
+
+  [[nodiscard]] static std::int64_t liveTotal() {
+    std::int64_t total = 0;
+    for (auto n : s_live)
+      total += n;
+    return total;
+  }
+
+  static void report(std::ostream& out) {
+    if (!s_installed) {
+      out << "GL trace not installed, run with --gl-trace" << std::endl;
+      return;
+    }
+    std::vector<int> order;
+    for (int i = 0; i < CALL_COUNT; ++i) {
+      if (s_last.calls[i])
+        order.push_back(i);
+    }
+    std::sort(order.begin(), order.end(), [](int a, int b) {
+      return s_last.calls[a] > s_last.calls[b];
+    });
+
+    out << "GL calls last frame: " << s_last.totalCalls()
+        << ", buffer bytes: " << s_last.buffer_bytes << '\n';
+    for (int i : order)
+      out << "  " << std::setw(26) << std::left << kCallNames[i] << std::right
+          << std::setw(8) << s_last.calls[i] << '\n';
+    out << "GL objects (created/deleted last frame, live):\n";
+    for (int t = 0; t < OBJ_COUNT; ++t)
+      out << "  " << std::setw(14) << std::left << kGLObjectNames[t] << std::right
+          << std::setw(6) << s_last.created[t] << std::setw(6) << s_last.deleted[t]
+          << std::setw(8) << s_live[t] << '\n';
+    out << std::flush;
+  }
+};
+}
+
+#endif // CUBE_SRC_ENGINE_GLTRACE_H_
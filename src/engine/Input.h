@@ -0,0 +1,26 @@
+#ifndef CUBE_SRC_ENGINE_INPUT_H_
+#define CUBE_SRC_ENGINE_INPUT_H_
+
+#include <chrono>
+#include <cstdint>
+
+#include "SpscQueue.h"
+
+namespace engine {
+inline std::int64_t now_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct s_input_event {
+  int key = 0;
+  int action = 0;
+  int mods = 0;
+  std::int64_t time_ns = 0; // steady clock, stamped when the event arrives
+};
+
+// The window callback pushes, the simulation step pops.
+using InputQueue = SpscQueue<s_input_event, 256>;
+}
+
+#endif // CUBE_SRC_ENGINE_INPUT_H_
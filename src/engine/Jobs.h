@@ -0,0 +1,444 @@
+#ifndef CUBE_SRC_ENGINE_JOBS_H_
+#define CUBE_SRC_ENGINE_JOBS_H_
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "Profiler.h"
+
+namespace engine {
+struct Job;
+
+// Jobs still to finish. Every job run() with a counter adds one, wait()
+// returns once all of them are done and after() starts its job then.
+// Lives until wait() on it returns.
+struct JobCounter {
+  std::atomic<int> pending{0};
+  std::atomic<int> finishing{0}; // jobs between their decrement and the end
+  std::atomic<Job*> continuations{nullptr};
+
+  [[nodiscard]] bool done() const {
+    return pending.load(std::memory_order_seq_cst) == 0 && finishing.load(std::memory_order_seq_cst) == 0;
+  }
+};
+
+struct alignas(64) Job {
+  static constexpr std::size_t kDataSize = 96;
+
+  void (*function)(Job&) = nullptr;
+  JobCounter* counter = nullptr;
+  Job* next = nullptr; // in a counter's continuation list
+  std::atomic<bool> finished{true};
+  alignas(16) std::byte data[kDataSize]; // the callable, stored in place
+};
+
+// Chase-Lev work-stealing deque. The owning thread pushes and pops at the
+// bottom without contention; other threads steal from the top, racing each
+// other (and the owner for the last job) on one compare-exchange.
+template <std::size_t Capacity>
+class WorkStealingDeque {
+  static_assert((Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+
+ protected:
+  alignas(64) std::atomic<std::int64_t> m_top{0};
+  alignas(64) std::atomic<std::int64_t> m_bottom{0};
+  std::array<std::atomic<Job*>, Capacity> m_jobs{};
+
+ public:
+  // owner only; false when full
+  bool push(Job* job) {
+    std::int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+    std::int64_t top = m_top.load(std::memory_order_acquire);
+    if (bottom - top >= (std::int64_t)Capacity)
+      return false;
+    m_jobs[bottom & (Capacity - 1)].store(job, std::memory_order_relaxed);
+    m_bottom.store(bottom + 1, std::memory_order_release); // publishes the job to thieves
+    return true;
+  }
+
+  // owner only, newest job first
+  Job* pop() {
+    std::int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+    // seq_cst so a thief cannot read the old bottom and the new top at once
+    m_bottom.store(bottom, std::memory_order_seq_cst);
+    std::int64_t top = m_top.load(std::memory_order_seq_cst);
+    if (top > bottom) {
+      m_bottom.store(bottom + 1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    Job* job = m_jobs[bottom & (Capacity - 1)].load(std::memory_order_relaxed);
+    if (top == bottom) {
+      // last job, a thief may be taking it too
+      if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        job = nullptr;
+      m_bottom.store(bottom + 1, std::memory_order_relaxed);
+    }
+    return job;
+  }
+
+  // any thread, oldest job first; `contended` is set when another thread
+  // won the race for it
+  Job* steal(bool& contended) {
+    std::int64_t top = m_top.load(std::memory_order_seq_cst);
+    std::int64_t bottom = m_bottom.load(std::memory_order_seq_cst);
+    if (top >= bottom)
+      return nullptr;
+    Job* job = m_jobs[top & (Capacity - 1)].load(std::memory_order_relaxed);
+    if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+      contended = true;
+      return nullptr;
+    }
+    return job;
+  }
+
+  [[nodiscard]] std::size_t size() const {
+    std::int64_t n = m_bottom.load(std::memory_order_relaxed) - m_top.load(std::memory_order_relaxed);
+    return n > 0 ? (std::size_t)n : 0;
+  }
+};
+
+struct s_job_stats {
+  std::uint64_t executed = 0;
+  std::uint64_t steal_attempts = 0; // victims probed
+  std::uint64_t steals = 0;         // jobs taken from another thread
+  std::uint64_t contended = 0;      // steals lost to another thread
+  std::uint64_t sleeps = 0;         // workers that ran out of work
+  std::uint64_t inline_runs = 0;    // jobs run at submission, no slot or deque full
+};
+
+// Job system with one work-stealing deque per thread. The workers plus the
+// threads that submit (each takes a slot on its first call) form the pool;
+// an idle thread steals from a random other slot and sleeps when nothing is
+// left. wait() does not block, the waiting thread runs jobs until its
+// counter is done. Jobs are callables of up to Job::kDataSize bytes kept in
+// a per-slot ring, so submitting does not allocate.
+class JobSystem {
+ public:
+  static constexpr std::size_t kDequeSize = 1024;
+  static constexpr std::size_t kRingSize = 1024; // jobs in flight per submitting thread
+  static constexpr std::size_t kExternalSlots = 4;
+
+ protected:
+  struct alignas(64) s_slot {
+    WorkStealingDeque<kDequeSize> deque;
+    std::unique_ptr<Job[]> ring = std::make_unique<Job[]>(kRingSize);
+    std::size_t next = 0; // ring position, owner only
+
+    std::atomic<std::uint64_t> executed{0}, stealAttempts{0}, steals{0}, contended{0}, sleeps{0};
+  };
+
+  static inline std::atomic<std::uint64_t> s_systems{0};
+  static inline thread_local std::uint64_t t_system = 0;
+  static inline thread_local std::size_t t_slot = 0;
+  static inline thread_local std::uint32_t t_random = 0x9E3779B9u;
+
+  std::uint64_t m_id = ++s_systems; // tells slots of a destroyed system apart
+  std::vector<std::unique_ptr<s_slot>> m_slots; // workers first, then the external ones
+  std::vector<std::thread> m_workers;
+  std::atomic<std::size_t> m_external{0};
+  std::atomic<bool> m_running{true};
+  std::atomic<std::uint32_t> m_epoch{0}; // bumped to wake sleeping workers
+  std::atomic<int> m_sleeping{0};
+  std::atomic<std::uint64_t> m_inlineRuns{0};
+
+  static constexpr std::size_t kNoSlot = ~(std::size_t)0;
+
+  // the calling thread's slot, taken on first use
+  std::size_t slot() {
+    if (t_system == m_id)
+      return t_slot;
+    std::size_t external = m_external.fetch_add(1, std::memory_order_relaxed);
+    if (external >= kExternalSlots) {
+      if (external == kExternalSlots)
+        std::cerr << "ERROR::JOBS::NO_SLOT more than " << kExternalSlots
+                  << " submitting threads, the rest run their jobs inline" << std::endl;
+      return kNoSlot;
+    }
+    t_system = m_id;
+    t_slot = m_workers.size() + external;
+    return t_slot;
+  }
+
+  void execute(Job& job, s_slot& slot) {
+    JobCounter* counter = job.counter;
+    job.function(job);
+    slot.executed.fetch_add(1, std::memory_order_relaxed);
+    job.finished.store(true, std::memory_order_release);
+    if (counter)
+      complete(*counter);
+  }
+
+  // one job of `counter` is done; the last one starts the continuations
+  void complete(JobCounter& counter) {
+    counter.finishing.fetch_add(1, std::memory_order_seq_cst);
+    if (counter.pending.fetch_sub(1, std::memory_order_seq_cst) == 1) {
+      Job* job = counter.continuations.exchange(nullptr, std::memory_order_acq_rel);
+      while (job) {
+        Job* next = job->next;
+        schedule(job);
+        job = next;
+      }
+    }
+    counter.finishing.fetch_sub(1, std::memory_order_seq_cst);
+  }
+
+  Job* find(std::size_t own) {
+    if (own != kNoSlot) {
+      if (Job* job = m_slots[own]->deque.pop())
+        return job;
+    }
+    if (m_slots.size() < 2)
+      return nullptr;
+    // steal, starting at a random victim
+    s_slot& self = *m_slots[own != kNoSlot ? own : 0];
+    t_random ^= t_random << 13;
+    t_random ^= t_random >> 17;
+    t_random ^= t_random << 5;
+    std::size_t start = t_random % m_slots.size();
+    for (std::size_t i = 0; i < m_slots.size(); ++i) {
+      std::size_t victim = (start + i) % m_slots.size();
+      if (victim == own || !m_slots[victim]->deque.size())
+        continue;
+      bool contended = false;
+      self.stealAttempts.fetch_add(1, std::memory_order_relaxed);
+      if (Job* job = m_slots[victim]->deque.steal(contended)) {
+        self.steals.fetch_add(1, std::memory_order_relaxed);
+        return job;
+      }
+      if (contended)
+        self.contended.fetch_add(1, std::memory_order_relaxed);
+    }
+    return nullptr;
+  }
+
+  void wake() {
+    // orders the push before the check, pairs with the increment in workerLoop
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_sleeping.load(std::memory_order_seq_cst) > 0) {
+      m_epoch.fetch_add(1, std::memory_order_seq_cst);
+      m_epoch.notify_all();
+    }
+  }
+
+  void schedule(Job* job) {
+    std::size_t own = slot();
+    if (own == kNoSlot || !m_slots[own]->deque.push(job)) {
+      m_inlineRuns.fetch_add(1, std::memory_order_relaxed);
+      execute(*job, *m_slots[own != kNoSlot ? own : 0]);
+      return;
+    }
+    wake();
+  }
+
+  void workerLoop(std::size_t index) {
+    t_system = m_id;
+    t_slot = index;
+    t_random = 0x9E3779B9u * (std::uint32_t)(index + 1);
+    std::string name = "job " + std::to_string(index + 1);
+    Profiler::setThreadName(name.c_str());
+    s_slot& self = *m_slots[index];
+    int idle = 0;
+    while (m_running.load(std::memory_order_acquire)) {
+      if (Job* job = find(index)) {
+        execute(*job, self);
+        idle = 0;
+        continue;
+      }
+      if (++idle < 64) {
+        std::this_thread::yield();
+        continue;
+      }
+      // announce the sleep, then look once more so a push in between is not missed
+      std::uint32_t epoch = m_epoch.load(std::memory_order_seq_cst);
+      m_sleeping.fetch_add(1, std::memory_order_seq_cst);
+      if (Job* job = find(index)) {
+        m_sleeping.fetch_sub(1, std::memory_order_seq_cst);
+        execute(*job, self);
+        idle = 0;
+        continue;
+      }
+      self.sleeps.fetch_add(1, std::memory_order_relaxed);
+      if (m_running.load(std::memory_order_acquire))
+        m_epoch.wait(epoch, std::memory_order_seq_cst);
+      m_sleeping.fetch_sub(1, std::memory_order_seq_cst);
+      idle = 0;
+    }
+  }
+
+  template <typename F>
+  Job* prepare(F&& function, JobCounter* counter) {
+    using Fn = std::decay_t<F>;
+    static_assert(sizeof(Fn) <= Job::kDataSize, "job callable too large, capture a pointer instead");
+    static_assert(alignof(Fn) <= 16, "job callable over-aligned");
+    std::size_t own = slot();
+    Job* job;
+    if (own == kNoSlot) {
+      job = nullptr;
+    } else {
+      s_slot& self = *m_slots[own];
+      // the ring may wrap onto jobs still queued or running (maybe further up
+      // this very stack), skip those; help out when every one is busy
+      for (std::size_t probe = 0;; ++probe) {
+        job = &self.ring[self.next++ & (kRingSize - 1)];
+        if (job->finished.load(std::memory_order_acquire))
+          break;
+        if (probe % kRingSize == kRingSize - 1) {
+          if (Job* other = find(own))
+            execute(*other, self);
+          else
+            std::this_thread::yield();
+        }
+      }
+    }
+    if (counter)
+      counter->pending.fetch_add(1, std::memory_order_seq_cst);
+    if (!job) {
+      // no slot for this thread: run right away
+      m_inlineRuns.fetch_add(1, std::memory_order_relaxed);
+      function();
+      if (counter)
+        complete(*counter);
+      return nullptr;
+    }
+    new (job->data) Fn(std::forward<F>(function));
+    job->function = [](Job& self) {
+      Fn& fn = *std::launder(reinterpret_cast<Fn*>(self.data));
+      fn();
+      fn.~Fn();
+    };
+    job->counter = counter;
+    job->next = nullptr;
+    job->finished.store(false, std::memory_order_relaxed);
+    return job;
+  }
+
+ public:
+  // `threads` counts the caller too; 0 uses every hardware thread
+  explicit JobSystem(unsigned threads = 0) {
+    if (!threads)
+      threads = std::max(1u, std::thread::hardware_concurrency());
+    std::size_t workers = threads - 1;
+    for (std::size_t i = 0; i < workers + kExternalSlots; ++i)
+      m_slots.push_back(std::make_unique<s_slot>());
+    m_workers.reserve(workers);
+    for (std::size_t i = 0; i < workers; ++i)
+      m_workers.emplace_back(&JobSystem::workerLoop, this, i);
+  }
+
+  JobSystem(const JobSystem&) = delete;
+  JobSystem& operator=(const JobSystem&) = delete;
+
+  // jobs still queued are dropped, wait for them first
+  ~JobSystem() {
+    m_running.store(false, std::memory_order_release);
+    m_epoch.fetch_add(1, std::memory_order_seq_cst);
+    m_epoch.notify_all();
+    for (auto& worker : m_workers)
+      worker.join();
+    if (t_system == m_id)
+      t_system = 0;
+  }
+
+  // queue `function` (callable as function()), counted in `counter`
+  template <typename F>
+  void run(F&& function, JobCounter* counter = nullptr) {
+    if (Job* job = prepare(std::forward<F>(function), counter))
+      schedule(job);
+  }
+
+  // queue `function` once every job of `dependency` is done
+  template <typename F>
+  void after(JobCounter& dependency, F&& function, JobCounter* counter = nullptr) {
+    if (slot() == kNoSlot) {
+      wait(dependency);
+      run(std::forward<F>(function), counter);
+      return;
+    }
+    Job* job = prepare(std::forward<F>(function), counter);
+    // hold the dependency open while the job is linked in
+    dependency.pending.fetch_add(1, std::memory_order_seq_cst);
+    Job* head = dependency.continuations.load(std::memory_order_relaxed);
+    do {
+      job->next = head;
+    } while (!dependency.continuations.compare_exchange_weak(head, job, std::memory_order_release,
+                                                             std::memory_order_relaxed));
+    complete(dependency);
+  }
+
+  // run jobs until every job of `counter` is done
+  void wait(JobCounter& counter) {
+    PROFILE_ZONE("JobSystem::wait");
+    std::size_t own = slot();
+    while (!counter.done()) {
+      if (Job* job = find(own))
+        execute(*job, *m_slots[own != kNoSlot ? own : 0]);
+      else
+        std::this_thread::yield();
+    }
+  }
+
+  // body(begin, end) over [first, first + count) in chunks of `grain`; the
+  // caller takes the first chunk and returns when all are done
+  template <typename F>
+  void parallel_for(std::size_t first, std::size_t count, std::size_t grain, F&& body) {
+    if (!count)
+      return;
+    grain = std::max<std::size_t>(grain, 1);
+    std::size_t chunks = (count + grain - 1) / grain;
+    std::size_t end = first + count;
+    if (chunks == 1 || m_workers.empty()) {
+      body(first, end);
+      return;
+    }
+    JobCounter counter;
+    auto* fn = &body;
+    for (std::size_t chunk = chunks - 1; chunk > 0; --chunk) {
+      std::size_t begin = first + chunk * grain;
+      run([fn, begin, end, grain] { (*fn)(begin, std::min(begin + grain, end)); }, &counter);
+    }
+    body(first, std::min(first + grain, end));
+    wait(counter);
+  }
+
+  // slot of the calling thread, below slots(); e.g. a RenderQueue producer
+  [[nodiscard]] std::size_t threadIndex() {
+    std::size_t own = slot();
+    return own != kNoSlot ? own : 0;
+  }
+
+  [[nodiscard]] std::size_t slots() const {
+    return m_slots.size();
+  }
+
+  // worker threads plus the caller
+  [[nodiscard]] std::size_t threads() const {
+    return m_workers.size() + 1;
+  }
+
+  [[nodiscard]] s_job_stats stats() const {
+    s_job_stats stats;
+    for (const auto& slot : m_slots) {
+      stats.executed += slot->executed.load(std::memory_order_relaxed);
+      stats.steal_attempts += slot->stealAttempts.load(std::memory_order_relaxed);
+      stats.steals += slot->steals.load(std::memory_order_relaxed);
+      stats.contended += slot->contended.load(std::memory_order_relaxed);
+      stats.sleeps += slot->sleeps.load(std::memory_order_relaxed);
+    }
+    stats.inline_runs = m_inlineRuns.load(std::memory_order_relaxed);
+    return stats;
+  }
+};
+}
+
+#endif // CUBE_SRC_ENGINE_JOBS_H_
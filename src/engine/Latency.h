@@ -0,0 +1,225 @@
+#ifndef CUBE_SRC_ENGINE_LATENCY_H_
+#define CUBE_SRC_ENGINE_LATENCY_H_
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "glad/gl.h"
+
+#include "GLRegistry.h"
+#include "Input.h"
+
+namespace engine {
+// Fixed 0.5 ms buckets up to 250 ms, everything slower lands in the last one.
+class LatencyHistogram {
+ public:
+  static constexpr int kBuckets = 501;
+  static constexpr std::int64_t kBucketNs = 500'000;
+
+ protected:
+  std::array<std::uint64_t, kBuckets> m_buckets{};
+  std::uint64_t m_count = 0;
+  std::int64_t m_sumNs = 0;
+  std::int64_t m_minNs = 0;
+  std::int64_t m_maxNs = 0;
+
+ public:
+  void add(std::int64_t ns) {
+    ns = std::max<std::int64_t>(ns, 0);
+    m_buckets[std::min<std::int64_t>(ns / kBucketNs, kBuckets - 1)]++;
+    m_minNs = m_count ? std::min(m_minNs, ns) : ns;
+    m_maxNs = std::max(m_maxNs, ns);
+    m_sumNs += ns;
+    m_count++;
+  }
+
+  void reset() {
+    *this = LatencyHistogram();
+  }
+
+  // upper edge of the bucket holding the p-th percentile, in milliseconds
+  [[nodiscard]] double percentile(double p) const {
+    if (!m_count)
+      return 0.0;
+    auto rank = (std::uint64_t)(p / 100.0 * (double)(m_count - 1)) + 1;
+    std::uint64_t seen = 0;
+    for (int i = 0; i < kBuckets; ++i) {
+      seen += m_buckets[i];
+      if (seen >= rank)
+        return (double)((i + 1) * kBucketNs) / 1e6;
+    }
+    return (double)m_maxNs / 1e6;
+  }
+
+  [[nodiscard]] std::uint64_t count() const {
+    return m_count;
+  }
+
+  [[nodiscard]] double meanMs() const {
+    return m_count ? (double)m_sumNs / (double)m_count / 1e6 : 0.0;
+  }
+
+  void print(std::ostream& out, const char* name) const {
+    out << std::fixed << std::setprecision(2)
+        << name << ": n=" << m_count
+        << " min=" << (double)m_minNs / 1e6
+        << " mean=" << meanMs()
+        << " p50=" << percentile(50.0)
+        << " p90=" << percentile(90.0)
+        << " p99=" << percentile(99.0)
+        << " max=" << (double)m_maxNs / 1e6 << " ms" << std::endl;
+  }
+
+  void printBuckets(std::ostream& out) const {
+    for (int i = 0; i < kBuckets; ++i) {
+      if (m_buckets[i])
+        out << "  <" << std::setw(6) << (double)((i + 1) * kBucketNs) / 1e6
+            << " ms " << m_buckets[i] << '\n';
+    }
+  }
+};
+
+// Input-to-photon latency: every turn carries the arrival time of its key
+// event, the frame that first shows it is stamped after glfwSwapBuffers and,
+// when GL timestamp queries are available, again when the GPU finished it.
+class LatencyTracker {
+ protected:
+  static constexpr int kFramesInFlight = 4;
+
+  struct s_gpu_frame {
+    GLuint query = 0;
+    bool inFlight = false;
+    std::vector<std::int64_t> inputs;
+  };
+
+  LatencyHistogram m_toSwap;
+  LatencyHistogram m_toGpu;
+
+  std::vector<std::int64_t> m_pending; // turns first shown in the frame being built
+  std::vector<std::int64_t> m_submitted;
+  std::array<s_gpu_frame, kFramesInFlight> m_frames;
+  int m_frame = 0;
+
+  bool m_gpuTiming = false;
+  std::int64_t m_gpuOffsetNs = 0; // steady clock minus GL timestamp
+
+  void calibrate() {
+    GLint64 gpu = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpu);
+    m_gpuOffsetNs = now_ns() - (std::int64_t)gpu;
+  }
+
+ public:
+  LatencyTracker() = default;
+  LatencyTracker(const LatencyTracker&) = delete;
+  LatencyTracker& operator=(const LatencyTracker&) = delete;
+
+  ~LatencyTracker() {
+    release();
+  }
+
+  // free the GL queries, must run while the context is still current
+  void release() {
+    for (auto& frame : m_frames) {
+      GLRegistry::destroy(OBJ_QUERY, frame.query);
+      frame.inFlight = false;
+    }
+    m_gpuTiming = false;
+  }
+
+  void init() {
+    m_gpuTiming = GLAD_GL_VERSION_3_3 || GLAD_GL_ARB_timer_query;
+    if (!m_gpuTiming)
+      return;
+    for (auto& frame : m_frames)
+      frame.query = GLRegistry::create(OBJ_QUERY, "LatencyTracker");
+    calibrate();
+  }
+
+  // a turn that was queued at `input_ns` is visible in the current frame
+  void markShown(std::int64_t input_ns) {
+    m_pending.push_back(input_ns);
+  }
+
+  // call after the last draw of the frame, before glfwSwapBuffers
+  void frameSubmitted() {
+    m_submitted.swap(m_pending);
+    m_pending.clear();
+    if (!m_gpuTiming || m_submitted.empty())
+      return;
+
+    s_gpu_frame& frame = m_frames[m_frame];
+    if (frame.inFlight)
+      return; // every slot is still waiting on the GPU, skip this sample
+    glQueryCounter(frame.query, GL_TIMESTAMP);
+    frame.inputs = m_submitted;
+    frame.inFlight = true;
+    m_frame = (m_frame + 1) % kFramesInFlight;
+  }
+
+  // call right after glfwSwapBuffers returned
+  void framePresented(std::int64_t swap_ns) {
+    for (std::int64_t input : m_submitted)
+      m_toSwap.add(swap_ns - input);
+    m_submitted.clear();
+    collect();
+  }
+
+  // read back finished timestamp queries without waiting on the GPU
+  void collect() {
+    for (auto& frame : m_frames) {
+      if (!frame.inFlight)
+        continue;
+      GLint available = 0;
+      glGetQueryObjectiv(frame.query, GL_QUERY_RESULT_AVAILABLE, &available);
+      if (!available)
+        continue;
+      GLuint64 gpu = 0;
+      glGetQueryObjectui64v(frame.query, GL_QUERY_RESULT, &gpu);
+      for (std::int64_t input : frame.inputs)
+        m_toGpu.add((std::int64_t)gpu + m_gpuOffsetNs - input);
+      frame.inputs.clear();
+      frame.inFlight = false;
+    }
+  }
+
+  void report(std::ostream& out) {
+    m_toSwap.print(out, "input->swap");
+    if (m_gpuTiming) {
+      m_toGpu.print(out, "input->gpu ");
+      calibrate();
+    }
+  }
+
+  bool writeLog(const char* path) {
+    std::ofstream log(path, std::ios::app);
+    if (!log) {
+      std::cerr << "ERROR::LATENCY::LOG_NOT_WRITTEN " << path << std::endl;
+      return false;
+    }
+    log << "# latency report at " << now_ns() << " ns\n";
+    m_toSwap.print(log, "input->swap");
+    m_toSwap.printBuckets(log);
+    if (m_gpuTiming) {
+      m_toGpu.print(log, "input->gpu ");
+      m_toGpu.printBuckets(log);
+    }
+    return true;
+  }
+
+  [[nodiscard]] const LatencyHistogram& toSwap() const {
+    return m_toSwap;
+  }
+
+  [[nodiscard]] const LatencyHistogram& toGpu() const {
+    return m_toGpu;
+  }
+};
+}
+
+#endif // CUBE_SRC_ENGINE_LATENCY_H_
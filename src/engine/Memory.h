@@ -0,0 +1,317 @@
+#ifndef CUBE_SRC_ENGINE_MEMORY_H_
+#define CUBE_SRC_ENGINE_MEMORY_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace engine {
+// Calls of the global operator new, counted by the replacement operators in
+// src/allocations.h. Steady-state frames are expected to leave them unchanged.
+class HeapStats {
+ protected:
+  static inline std::atomic<std::uint64_t> s_allocations{0};
+  static inline std::atomic<std::uint64_t> s_bytes{0};
+  static inline thread_local std::uint64_t t_allocations = 0;
+
+ public:
+  static void count(std::size_t bytes) noexcept {
+    s_allocations.fetch_add(1, std::memory_order_relaxed);
+    s_bytes.fetch_add(bytes, std::memory_order_relaxed);
+    t_allocations++;
+  }
+
+  [[nodiscard]] static std::uint64_t allocations() {
+    return s_allocations.load(std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] static std::uint64_t bytes() {
+    return s_bytes.load(std::memory_order_relaxed);
+  }
+
+  // allocations made by the calling thread
+  [[nodiscard]] static std::uint64_t threadAllocations() {
+    return t_allocations;
+  }
+};
+
+// Linear allocator for temporaries that live until the end of the frame (or
+// simulation tick). Allocation is a pointer bump, reset() drops everything at
+// once; nothing is destructed, so only trivially destructible types go in.
+// A frame that does not fit takes the rest from the heap, and the arena grows
+// to that frame's size at the next reset, so the steady state never does.
+class FrameArena {
+ protected:
+  std::unique_ptr<std::byte[]> m_memory;
+  std::size_t m_capacity = 0;
+  std::size_t m_used = 0;
+  std::vector<void*> m_overflow; // heap blocks of the current frame
+  std::size_t m_overflowBytes = 0;
+
+  // debug statistics
+  std::size_t m_peak = 0;
+  std::size_t m_lastUsed = 0;
+  std::uint64_t m_allocations = 0;
+  std::uint64_t m_lastAllocations = 0;
+  std::uint64_t m_overflows = 0;
+
+ public:
+  explicit FrameArena(std::size_t capacity = 256 * 1024)
+      : m_memory(std::make_unique<std::byte[]>(capacity)), m_capacity(capacity) {}
+  FrameArena(const FrameArena&) = delete;
+  FrameArena& operator=(const FrameArena&) = delete;
+
+  ~FrameArena() {
+    for (void* block : m_overflow)
+      std::free(block);
+  }
+
+  // the calling thread's arena, reset by the loop that owns the thread
+  static FrameArena& thread() {
+    thread_local FrameArena arena;
+    return arena;
+  }
+
+  void* allocate(std::size_t bytes, std::size_t align = alignof(std::max_align_t)) {
+    m_allocations++;
+    auto base = reinterpret_cast<std::uintptr_t>(m_memory.get());
+    std::size_t offset = (std::size_t)(((base + m_used + align - 1) & ~(std::uintptr_t)(align - 1)) - base);
+    if (offset + bytes <= m_capacity) {
+      m_used = offset + bytes;
+      return m_memory.get() + offset;
+    }
+    void* block = std::aligned_alloc(align, (bytes + align - 1) / align * align);
+    if (!block)
+      throw std::bad_alloc();
+    if (!m_overflows++)
+      std::cerr << "ERROR::FRAME_ARENA::OVERFLOW " << m_capacity << " bytes, growing at the next reset"
+                << std::endl;
+    m_overflow.push_back(block);
+    m_overflowBytes += bytes + align;
+    return block;
+  }
+
+  template <typename T>
+  T* allocate(std::size_t count) {
+    static_assert(std::is_trivially_destructible_v<T>, "FrameArena never runs destructors");
+    return static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+  }
+
+  // end of frame: everything allocated since the last reset is gone
+  void reset() {
+    std::size_t needed = m_used + m_overflowBytes;
+    m_lastUsed = needed;
+    m_peak = std::max(m_peak, needed);
+    m_lastAllocations = m_allocations;
+    m_allocations = 0;
+    if (!m_overflow.empty()) {
+      for (void* block : m_overflow)
+        std::free(block);
+      m_overflow.clear();
+      m_overflowBytes = 0;
+      m_capacity = std::max(m_capacity * 2, needed);
+      m_memory = std::make_unique<std::byte[]>(m_capacity);
+    }
+    m_used = 0;
+  }
+
+  [[nodiscard]] std::size_t capacity() const {
+    return m_capacity;
+  }
+
+  [[nodiscard]] std::size_t used() const {
+    return m_used + m_overflowBytes;
+  }
+
+  [[nodiscard]] std::size_t peak() const {
+    return std::max(m_peak, used());
+  }
+
+  // bytes and allocations of the last finished frame
+  [[nodiscard]] std::size_t lastUsed() const {
+    return m_lastUsed;
+  }
+
+  [[nodiscard]] std::uint64_t lastAllocations() const {
+    return m_lastAllocations;
+  }
+
+  [[nodiscard]] std::uint64_t overflows() const {
+    return m_overflows;
+  }
+};
+
+// std allocator on a FrameArena, for containers that die with the frame
+template <typename T>
+class ArenaAllocator {
+ public:
+  using value_type = T;
+
+  FrameArena* arena;
+
+  explicit ArenaAllocator(FrameArena& frameArena = FrameArena::thread()) : arena(&frameArena) {}
+
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+  T* allocate(std::size_t count) {
+    return arena->allocate<T>(count);
+  }
+
+  void deallocate(T*, std::size_t) {}
+
+  template <typename U>
+  bool operator==(const ArenaAllocator<U>& other) const {
+    return arena == other.arena;
+  }
+};
+
+template <typename T>
+using FrameVector = std::vector<T, ArenaAllocator<T>>;
+
+// Fixed-size slots for long-lived objects of one type. Slots come in blocks
+// of BlockSize that are kept until the pool dies; freed slots go on a free
+// list and are reused first, so create/destroy cycles do not touch the heap.
+// Not thread safe, each pool belongs to one thread.
+template <typename T, std::size_t BlockSize = 64>
+class Pool {
+ protected:
+  union s_slot {
+    s_slot* next;
+    alignas(T) std::byte storage[sizeof(T)];
+  };
+
+  std::vector<std::unique_ptr<s_slot[]>> m_blocks;
+  s_slot* m_free = nullptr;
+
+  // debug statistics
+  std::size_t m_live = 0;
+  std::size_t m_peak = 0;
+  std::uint64_t m_allocations = 0;
+
+  void grow() {
+    m_blocks.push_back(std::make_unique<s_slot[]>(BlockSize));
+    s_slot* block = m_blocks.back().get();
+    for (std::size_t i = BlockSize; i-- > 0;) {
+      block[i].next = m_free;
+      m_free = &block[i];
+    }
+  }
+
+ public:
+  Pool() = default;
+  Pool(const Pool&) = delete;
+  Pool& operator=(const Pool&) = delete;
+
+  ~Pool() {
+    if (m_live)
+      std::cerr << "ERROR::POOL::LEAKED " << m_live << " object(s) still alive" << std::endl;
+  }
+
+  template <typename... Args>
+  T* create(Args&&... args) {
+    if (!m_free)
+      grow();
+    s_slot* slot = m_free;
+    m_free = slot->next;
+    T* object = new (slot->storage) T(std::forward<Args>(args)...);
+    m_live++;
+    m_peak = std::max(m_peak, m_live);
+    m_allocations++;
+    return object;
+  }
+
+  void destroy(T* object) {
+    if (!object)
+      return;
+    object->~T();
+    auto* slot = reinterpret_cast<s_slot*>(object);
+    slot->next = m_free;
+    m_free = slot;
+    m_live--;
+  }
+
+  // make room for `count` live objects up front
+  void reserve(std::size_t count) {
+    while (capacity() < count)
+      grow();
+  }
+
+  [[nodiscard]] std::size_t live() const {
+    return m_live;
+  }
+
+  [[nodiscard]] std::size_t peak() const {
+    return m_peak;
+  }
+
+  [[nodiscard]] std::size_t capacity() const {
+    return m_blocks.size() * BlockSize;
+  }
+
+  [[nodiscard]] std::uint64_t allocations() const {
+    return m_allocations;
+  }
+};
+
+// FIFO on a ring that only grows, so a steady stream of pushes and pops
+// never allocates (std::deque frees and allocates a block every few items).
+template <typename T>
+class RingQueue {
+ protected:
+  std::vector<T> m_items; // capacity is a power of two
+  std::size_t m_head = 0;
+  std::size_t m_size = 0;
+
+  void grow() {
+    std::vector<T> items(std::max<std::size_t>(16, m_items.size() * 2));
+    for (std::size_t i = 0; i < m_size; ++i)
+      items[i] = std::move(m_items[(m_head + i) & (m_items.size() - 1)]);
+    m_items.swap(items);
+    m_head = 0;
+  }
+
+ public:
+  void push_back(const T& item) {
+    if (m_size == m_items.size())
+      grow();
+    m_items[(m_head + m_size) & (m_items.size() - 1)] = item;
+    m_size++;
+  }
+
+  [[nodiscard]] T& front() {
+    return m_items[m_head];
+  }
+
+  [[nodiscard]] const T& front() const {
+    return m_items[m_head];
+  }
+
+  void pop_front() {
+    m_head = (m_head + 1) & (m_items.size() - 1);
+    m_size--;
+  }
+
+  void clear() {
+    m_head = m_size = 0;
+  }
+
+  [[nodiscard]] bool empty() const {
+    return m_size == 0;
+  }
+
+  [[nodiscard]] std::size_t size() const {
+    return m_size;
+  }
+};
+}
+
+#endif // CUBE_SRC_ENGINE_MEMORY_H_
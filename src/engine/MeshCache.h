@@ -0,0 +1,170 @@
+#ifndef CUBE_SRC_ENGINE_MESHCACHE_H_
+#define CUBE_SRC_ENGINE_MESHCACHE_H_
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "glad/gl.h"
+
+#include "FrameStats.h"
+#include "GLRegistry.h"
+#include "Profiler.h"
+#include "Primitives.h"
+
+namespace engine {
+// where a mesh lives in the cache's shared buffers
+struct s_mesh_range {
+  std::uint32_t base_vertex = 0;
+  std::uint32_t first_index = 0;
+  std::uint32_t index_count = 0;
+  std::uint32_t vertex_count = 0;
+};
+
+// Primitive meshes, generated once per distinct parameter set and handed
+// out by id: 10000 boxes of the same size share one mesh and are told apart
+// only by their model matrices. All meshes are suballocated from one vertex
+// and one index buffer behind a single VAO (position at location 0, uv at
+// 2, normal at 3), so switching meshes costs no binds. Location 1 is left
+// free: rubikVertex.glsl reads per-vertex colors there and takes those of a
+// cached mesh from uniforms instead. get() only generates on the CPU; new
+// meshes reach the GPU at the next bind() on the GL thread. Not thread
+// safe, meant for the thread that builds the scene.
+class MeshCache {
+ protected:
+  std::unordered_map<primitives::s_primitive, std::uint32_t, primitives::s_primitive_hash> m_lookup;
+  std::vector<s_mesh_range> m_meshes;
+  // every mesh, the buffers are refilled from here when they grow
+  std::vector<primitives::s_mesh_vertex> m_vertices;
+  std::vector<std::uint32_t> m_indices;
+  std::uint64_t m_requests = 0;
+
+  GLuint m_vao = 0, m_vbo = 0, m_ebo = 0;
+  std::size_t m_vertexCapacity = 0, m_indexCapacity = 0; // elements the buffers hold
+  std::size_t m_uploadedVertices = 0, m_uploadedIndices = 0;
+
+  // append elements [uploaded, data.size()) to `buffer`, reallocating it to
+  // the next power of two (and uploading everything) when it is full
+  template <typename T>
+  static void sync(GLenum target, GLuint buffer, const std::vector<T>& data, std::size_t& capacity,
+                   std::size_t& uploaded) {
+    if (uploaded == data.size())
+      return;
+    if (data.size() > capacity) {
+      capacity = std::bit_ceil(std::max<std::size_t>(data.size(), 1024));
+      glBufferData(target, (GLsizeiptr)(capacity * sizeof(T)), nullptr, GL_STATIC_DRAW);
+      GLRegistry::setBytes(OBJ_BUFFER, buffer, capacity * sizeof(T));
+      uploaded = 0;
+    }
+    std::size_t bytes = (data.size() - uploaded) * sizeof(T);
+    glBufferSubData(target, (GLintptr)(uploaded * sizeof(T)), (GLsizeiptr)bytes, data.data() + uploaded);
+    FrameStats::current().bytes_uploaded += bytes;
+    uploaded = data.size();
+  }
+
+ public:
+  MeshCache() = default;
+  MeshCache(const MeshCache&) = delete;
+  MeshCache& operator=(const MeshCache&) = delete;
+
+  ~MeshCache() {
+    release();
+  }
+
+  // the id of the mesh for `primitive`, generating it on first use
+  std::uint32_t get(const primitives::s_primitive& primitive) {
+    m_requests++;
+    auto found = m_lookup.find(primitive);
+    if (found != m_lookup.end())
+      return found->second;
+
+    PROFILE_ZONE("MeshCache::generate");
+    primitives::s_mesh_data mesh = primitives::make_mesh(primitive);
+    s_mesh_range range;
+    range.base_vertex = (std::uint32_t)m_vertices.size();
+    range.first_index = (std::uint32_t)m_indices.size();
+    range.index_count = (std::uint32_t)mesh.indices.size();
+    range.vertex_count = (std::uint32_t)mesh.vertices.size();
+    m_vertices.insert(m_vertices.end(), mesh.vertices.begin(), mesh.vertices.end());
+    m_indices.insert(m_indices.end(), mesh.indices.begin(), mesh.indices.end());
+
+    auto id = (std::uint32_t)m_meshes.size();
+    m_meshes.push_back(range);
+    m_lookup.emplace(primitive, id);
+    return id;
+  }
+
+  [[nodiscard]] const s_mesh_range& range(std::uint32_t id) const {
+    return m_meshes[id];
+  }
+
+  // upload the meshes added since the last call and bind the shared VAO
+  void bind() {
+    if (!m_vao) {
+      m_vao = GLRegistry::create(OBJ_VERTEX_ARRAY, "MeshCache");
+      m_vbo = GLRegistry::create(OBJ_BUFFER, "MeshCache");
+      m_ebo = GLRegistry::create(OBJ_BUFFER, "MeshCache");
+      glBindVertexArray(m_vao);
+      glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+      glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
+      using V = primitives::s_mesh_vertex;
+      glEnableVertexAttribArray(0);
+      glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(V), (void*)offsetof(V, position));
+      glEnableVertexAttribArray(2);
+      glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(V), (void*)offsetof(V, uv));
+      glEnableVertexAttribArray(3);
+      glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(V), (void*)offsetof(V, normal));
+    } else {
+      glBindVertexArray(m_vao);
+    }
+    if (m_uploadedVertices != m_vertices.size() || m_uploadedIndices != m_indices.size()) {
+      PROFILE_ZONE("MeshCache::upload");
+      // the VAO keeps the element buffer binding, the vertex buffer is bound for the upload
+      glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+      sync(GL_ARRAY_BUFFER, m_vbo, m_vertices, m_vertexCapacity, m_uploadedVertices);
+      sync(GL_ELEMENT_ARRAY_BUFFER, m_ebo, m_indices, m_indexCapacity, m_uploadedIndices);
+    }
+  }
+
+  // draw `instances` copies of a mesh, after bind()
+  void draw(std::uint32_t id, GLsizei instances = 1) const {
+    const s_mesh_range& range = m_meshes[id];
+    auto* offset = (void*)(range.first_index * sizeof(std::uint32_t));
+    if (instances == 1)
+      glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)range.index_count, GL_UNSIGNED_INT, offset,
+                               (GLint)range.base_vertex);
+    else
+      glDrawElementsInstancedBaseVertex(GL_TRIANGLES, (GLsizei)range.index_count, GL_UNSIGNED_INT, offset,
+                                        instances, (GLint)range.base_vertex);
+    FrameStats::current().draw_calls++;
+  }
+
+  // free the buffers, must run while the context is still current; the
+  // meshes stay and are uploaded again by the next bind()
+  void release() {
+    GLRegistry::destroy(OBJ_VERTEX_ARRAY, m_vao);
+    GLRegistry::destroy(OBJ_BUFFER, m_vbo);
+    GLRegistry::destroy(OBJ_BUFFER, m_ebo);
+    m_vertexCapacity = m_indexCapacity = 0;
+    m_uploadedVertices = m_uploadedIndices = 0;
+  }
+
+  [[nodiscard]] std::size_t meshes() const {
+    return m_meshes.size();
+  }
+
+  // get() calls, found or generated
+  [[nodiscard]] std::uint64_t requests() const {
+    return m_requests;
+  }
+
+  [[nodiscard]] std::size_t bytes() const {
+    return m_vertices.size() * sizeof(primitives::s_mesh_vertex) + m_indices.size() * sizeof(std::uint32_t);
+  }
+};
+}
+
+#endif // CUBE_SRC_ENGINE_MESHCACHE_H_
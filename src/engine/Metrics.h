@@ -0,0 +1,281 @@
+#ifndef CUBE_SRC_ENGINE_METRICS_H_
+#define CUBE_SRC_ENGINE_METRICS_H_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "GLRegistry.h"
+#include "Input.h"
+#include "Memory.h"
+
+namespace engine {
+// Counters for long-running deployments. The render and simulation threads
+// only do relaxed atomic adds; MetricsExporter reads them from its own thread.
+class Metrics {
+ public:
+  static constexpr double kBucketMs = 0.25;
+  static constexpr std::size_t kBuckets = 256; // 0-64 ms, the last one is open ended
+
+ protected:
+  static inline std::array<std::atomic<std::uint64_t>, kBuckets> s_frameBuckets{};
+  static inline std::atomic<std::uint64_t> s_frames{0};
+  static inline std::atomic<std::uint64_t> s_frameTimeUs{0};
+  static inline std::atomic<std::uint64_t> s_dropped{0};
+  static inline std::atomic<std::uint64_t> s_moves{0};
+
+ public:
+  // a frame took `ms`; it counts as dropped past 1.5 budgets, i.e. a vsync missed
+  static void frame(float ms, float budget_ms) {
+    auto bucket = (std::size_t)((double)ms / kBucketMs);
+    s_frameBuckets[bucket < kBuckets ? bucket : kBuckets - 1].fetch_add(1, std::memory_order_relaxed);
+    s_frames.fetch_add(1, std::memory_order_relaxed);
+    s_frameTimeUs.fetch_add((std::uint64_t)(ms * 1000.0f), std::memory_order_relaxed);
+    if (ms > budget_ms * 1.5f)
+      s_dropped.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  static void moveStarted() {
+    s_moves.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] static std::uint64_t frameBucket(std::size_t i) {
+    return s_frameBuckets[i].load(std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] static std::uint64_t frames() {
+    return s_frames.load(std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] static double frameTimeSeconds() {
+    return (double)s_frameTimeUs.load(std::memory_order_relaxed) / 1e6;
+  }
+
+  [[nodiscard]] static std::uint64_t dropped() {
+    return s_dropped.load(std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] static std::uint64_t moves() {
+    return s_moves.load(std::memory_order_relaxed);
+  }
+};
+
+// Writes the counters in the Prometheus text format every `interval`
+// seconds, either to a file (replaced atomically through a rename, for the
+// node exporter textfile collector) or, for a target of the form
+// "unix:PATH", to whoever connects to a Unix socket at PATH.
+class MetricsExporter {
+ protected:
+  std::string m_path;
+  bool m_socket = false;
+  int m_listen = -1;
+  double m_interval = 10.0;
+  std::int64_t m_start = 0;
+  std::thread m_thread;
+  std::atomic<bool> m_running{false};
+
+  // frame buckets at the previous export, quantiles cover the interval since
+  std::array<std::uint64_t, Metrics::kBuckets> m_previous{};
+  std::array<double, 3> m_quantiles{};
+
+  static std::uint64_t residentBytes() {
+    std::ifstream statm("/proc/self/statm");
+    std::uint64_t size = 0, resident = 0;
+    statm >> size >> resident;
+    return resident * (std::uint64_t)sysconf(_SC_PAGESIZE);
+  }
+
+  void updateQuantiles() {
+    std::array<std::uint64_t, Metrics::kBuckets> delta{};
+    std::uint64_t total = 0;
+    for (std::size_t i = 0; i < Metrics::kBuckets; ++i) {
+      std::uint64_t now = Metrics::frameBucket(i);
+      delta[i] = now - m_previous[i];
+      m_previous[i] = now;
+      total += delta[i];
+    }
+    if (!total)
+      return; // keep the last values while no frames are drawn
+    const double ranks[] = {0.5, 0.95, 0.99};
+    for (std::size_t q = 0; q < m_quantiles.size(); ++q) {
+      auto target = (std::uint64_t)(ranks[q] * (double)total);
+      std::uint64_t seen = 0;
+      for (std::size_t i = 0; i < Metrics::kBuckets; ++i) {
+        seen += delta[i];
+        if (seen > target) {
+          m_quantiles[q] = ((double)i + 0.5) * Metrics::kBucketMs / 1000.0;
+          break;
+        }
+      }
+    }
+  }
+
+  [[nodiscard]] std::string format() const {
+    std::ostringstream out;
+    auto metric = [&out](const char* name, const char* type, const char* help) {
+      out << "# HELP " << name << ' ' << help << "\n# TYPE " << name << ' ' << type << '\n';
+    };
+    metric("cube_uptime_seconds", "gauge", "Seconds since the exporter started.");
+    out << "cube_uptime_seconds " << (double)(now_ns() - m_start) / 1e9 << '\n';
+    metric("cube_frames_total", "counter", "Frames presented.");
+    out << "cube_frames_total " << Metrics::frames() << '\n';
+    metric("cube_dropped_frames_total", "counter", "Frames longer than 1.5 frame budgets.");
+    out << "cube_dropped_frames_total " << Metrics::dropped() << '\n';
+    metric("cube_frame_time_quantile_seconds", "gauge", "Frame time quantiles over the last export interval.");
+    const char* labels[] = {"0.5", "0.95", "0.99"};
+    for (std::size_t q = 0; q < m_quantiles.size(); ++q)
+      out << "cube_frame_time_quantile_seconds{quantile=\"" << labels[q] << "\"} " << m_quantiles[q] << '\n';
+
+    metric("cube_frame_time_seconds", "histogram", "Frame time since start.");
+    const double bounds[] = {0.004, 0.007, 0.0085, 0.0125, 0.017, 0.025, 0.034, 0.05};
+    std::uint64_t cumulative = 0;
+    std::size_t bucket = 0;
+    for (double bound : bounds) {
+      for (; bucket < Metrics::kBuckets - 1 && (double)(bucket + 1) * Metrics::kBucketMs <= bound * 1000.0; ++bucket)
+        cumulative += Metrics::frameBucket(bucket);
+      out << "cube_frame_time_seconds_bucket{le=\"" << bound << "\"} " << cumulative << '\n';
+    }
+    out << "cube_frame_time_seconds_bucket{le=\"+Inf\"} " << Metrics::frames() << '\n';
+    out << "cube_frame_time_seconds_sum " << Metrics::frameTimeSeconds() << '\n';
+    out << "cube_frame_time_seconds_count " << Metrics::frames() << '\n';
+
+    metric("cube_moves_total", "counter", "Wall turns started.");
+    out << "cube_moves_total " << Metrics::moves() << '\n';
+    metric("cube_gl_memory_bytes", "gauge", "Estimated GPU memory of live GL buffers and textures.");
+    out << "cube_gl_memory_bytes " << GLRegistry::bytes() << '\n';
+    metric("cube_gl_objects", "gauge", "Live GL objects.");
+    out << "cube_gl_objects " << GLRegistry::liveTotal() << '\n';
+    metric("cube_heap_allocations_total", "counter", "Calls of the global operator new.");
+    out << "cube_heap_allocations_total " << HeapStats::allocations() << '\n';
+    metric("cube_resident_memory_bytes", "gauge", "Resident set size of the process.");
+    out << "cube_resident_memory_bytes " << residentBytes() << '\n';
+    return out.str();
+  }
+
+  void writeFile(const std::string& text) const {
+    std::string temp = m_path + ".tmp";
+    {
+      std::ofstream out(temp, std::ios::trunc);
+      if (!out) {
+        std::cerr << "ERROR::METRICS::NOT_WRITTEN " << temp << std::endl;
+        return;
+      }
+      out << text;
+    }
+    if (std::rename(temp.c_str(), m_path.c_str()) != 0)
+      std::cerr << "ERROR::METRICS::NOT_RENAMED " << m_path << std::endl;
+  }
+
+  // answer one connection; a plain HTTP GET gets a response header first
+  void serve(const std::string& text) const {
+    int client = accept(m_listen, nullptr, nullptr);
+    if (client < 0)
+      return;
+    char request[512];
+    pollfd readable{client, POLLIN, 0};
+    ssize_t n = poll(&readable, 1, 50) > 0 ? recv(client, request, sizeof(request), 0) : 0;
+    std::string response;
+    if (n >= 4 && std::string(request, 4) == "GET ")
+      response = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " +
+                 std::to_string(text.size()) + "\r\n\r\n";
+    response += text;
+    for (std::size_t sent = 0; sent < response.size();) {
+      ssize_t w = send(client, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+      if (w <= 0)
+        break;
+      sent += (std::size_t)w;
+    }
+    close(client);
+  }
+
+  void run() {
+    auto next = std::chrono::steady_clock::now();
+    std::string text;
+    while (m_running.load(std::memory_order_acquire)) {
+      auto now = std::chrono::steady_clock::now();
+      if (now >= next) {
+        updateQuantiles();
+        text = format();
+        if (!m_socket)
+          writeFile(text);
+        next = now + std::chrono::milliseconds((std::int64_t)(m_interval * 1000.0));
+      }
+      if (m_socket) {
+        pollfd ready{m_listen, POLLIN, 0};
+        if (poll(&ready, 1, 200) > 0)
+          serve(text);
+      } else {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+      }
+    }
+  }
+
+ public:
+  MetricsExporter() = default;
+  MetricsExporter(const MetricsExporter&) = delete;
+  MetricsExporter& operator=(const MetricsExporter&) = delete;
+
+  ~MetricsExporter() {
+    stop();
+  }
+
+  bool start(const std::string& target, double interval) {
+    m_socket = target.rfind("unix:", 0) == 0;
+    m_path = m_socket ? target.substr(5) : target;
+    m_interval = interval;
+    m_start = now_ns();
+    if (m_socket) {
+      sockaddr_un address{};
+      address.sun_family = AF_UNIX;
+      if (m_path.size() >= sizeof(address.sun_path)) {
+        std::cerr << "ERROR::METRICS::SOCKET_PATH_TOO_LONG " << m_path << std::endl;
+        return false;
+      }
+      std::snprintf(address.sun_path, sizeof(address.sun_path), "%s", m_path.c_str());
+      unlink(m_path.c_str());
+      m_listen = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+      if (m_listen < 0 || bind(m_listen, (sockaddr*)&address, sizeof(address)) != 0 ||
+          listen(m_listen, 4) != 0) {
+        std::cerr << "ERROR::METRICS::SOCKET_NOT_OPENED " << m_path << std::endl;
+        if (m_listen >= 0)
+          close(m_listen);
+        m_listen = -1;
+        return false;
+      }
+      fcntl(m_listen, F_SETFL, O_NONBLOCK);
+    }
+    m_running.store(true, std::memory_order_release);
+    m_thread = std::thread(&MetricsExporter::run, this);
+    return true;
+  }
+
+  void stop() {
+    if (!m_running.exchange(false))
+      return;
+    m_thread.join();
+    if (m_socket) {
+      close(m_listen);
+      unlink(m_path.c_str());
+      m_listen = -1;
+    } else {
+      updateQuantiles();
+      writeFile(format()); // final values
+    }
+  }
+};
+}
+
+#endif // CUBE_SRC_ENGINE_METRICS_H_
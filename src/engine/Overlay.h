@@ -0,0 +1,286 @@
+#ifndef CUBE_SRC_ENGINE_OVERLAY_H_
+#define CUBE_SRC_ENGINE_OVERLAY_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "glad/gl.h"
+
+#include "glm/glm.hpp"
+
+#include "FrameStats.h"
+#include "GLRegistry.h"
+#include "Assets.h"
+#include "Shader.h"
+
+namespace engine {
+// 5x7 bitmap font, one byte per row with the leftmost pixel in bit 4.
+// Lower case letters are drawn with the upper case glyphs.
+struct s_glyph {
+  char c;
+  std::uint8_t rows[7];
+};
+
+constexpr s_glyph kFont[] = {
+    {'0', {0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E}},
+    {'1', {0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E}},
+    {'2', {0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F}},
+    {'3', {0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E}},
+    {'4', {0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02}},
+    {'5', {0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E}},
+    {'6', {0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E}},
+    {'7', {0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08}},
+    {'8', {0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E}},
+    {'9', {0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C}},
+    {'A', {0x0E, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11}},
+    {'B', {0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E}},
+    {'C', {0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E}},
+    {'D', {0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C}},
+    {'E', {0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F}},
+    {'F', {0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10}},
+    {'G', {0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F}},
+    {'H', {0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11}},
+    {'I', {0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E}},
+    {'J', {0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C}},
+    {'K', {0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11}},
+    {'L', {0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F}},
+    {'M', {0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11}},
+    {'N', {0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11}},
+    {'O', {0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E}},
+    {'P', {0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10}},
+    {'Q', {0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D}},
+    {'R', {0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11}},
+    {'S', {0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E}},
+    {'T', {0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04}},
+    {'U', {0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E}},
+    {'V', {0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04}},
+    {'W', {0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A}},
+    {'X', {0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11}},
+    {'Y', {0x11, 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04}},
+    {'Z', {0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F}},
+    {'.', {0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C}},
+    {',', {0x00, 0x00, 0x00, 0x00, 0x0C, 0x04, 0x08}},
+    {':', {0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00}},
+    {'%', {0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03}},
+    {'/', {0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00}},
+    {'-', {0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00}},
+    {'+', {0x00, 0x04, 0x04, 0x1F, 0x04, 0x04, 0x00}},
+    {'=', {0x00, 0x00, 0x1F, 0x00, 0x1F, 0x00, 0x00}},
+    {'_', {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1F}},
+    {'(', {0x02, 0x04, 0x08, 0x08, 0x08, 0x04, 0x02}},
+    {')', {0x08, 0x04, 0x02, 0x02, 0x02, 0x04, 0x08}},
+    {'<', {0x02, 0x04, 0x08, 0x10, 0x08, 0x04, 0x02}},
+    {'>', {0x08, 0x04, 0x02, 0x01, 0x02, 0x04, 0x08}},
+};
+
+// Screen-space text and bars batched into one dynamic vertex buffer and
+// drawn with a single call from a glyph atlas. The batch is rebuilt only
+// when its content changes, an unchanged overlay costs one bind and draw.
+class Overlay {
+ public:
+  static constexpr int kCellW = 6; // glyph plus one pixel of spacing
+  static constexpr int kCellH = 8;
+  static constexpr int kAtlasCols = 16;
+  static constexpr int kAtlasRows = 8; // ASCII 0-127
+  static constexpr char kSolid = 127;  // fully lit cell, used for bars
+
+ protected:
+  struct s_vertex {
+    glm::vec2 position; // pixels, origin top-left
+    glm::vec2 uv;
+    std::uint32_t color; // RGBA8
+  };
+
+  Shader m_shader;
+  GLuint m_vao = 0, m_vbo = 0, m_atlas = 0;
+  std::vector<s_vertex> m_vertices;
+  std::size_t m_capacity = 0; // vertices the GL buffer can hold
+  std::size_t m_uploaded = 0;
+  bool m_dirty = false;
+  bool m_visible = false;
+  float m_scale = 2.0f;
+
+  static std::uint32_t pack(const glm::vec4& c) {
+    auto byte = [](float v) {
+      return (std::uint32_t)(glm::clamp(v, 0.0f, 1.0f) * 255.0f + 0.5f);
+    };
+    return byte(c.x) | byte(c.y) << 8 | byte(c.z) << 16 | byte(c.w) << 24;
+  }
+
+  void quad(float x, float y, float w, float h, glm::vec2 uv0, glm::vec2 uv1, std::uint32_t color) {
+    s_vertex a{{x, y}, uv0, color};
+    s_vertex b{{x + w, y}, {uv1.x, uv0.y}, color};
+    s_vertex c{{x + w, y + h}, uv1, color};
+    s_vertex d{{x, y + h}, {uv0.x, uv1.y}, color};
+    m_vertices.insert(m_vertices.end(), {a, b, c, c, d, a});
+  }
+
+  static void cellUv(char c, glm::vec2& uv0, glm::vec2& uv1) {
+    int index = (unsigned char)c & 0x7f;
+    float u = (float)(index % kAtlasCols * kCellW);
+    float v = (float)(index / kAtlasCols * kCellH);
+    float w = (float)(kAtlasCols * kCellW), h = (float)(kAtlasRows * kCellH);
+    uv0 = {u / w, v / h};
+    uv1 = {(u + (float)kCellW) / w, (v + (float)kCellH) / h};
+  }
+
+  void buildAtlas() {
+    const int width = kAtlasCols * kCellW, height = kAtlasRows * kCellH;
+    std::vector<std::uint8_t> pixels(width * height, 0);
+    auto cell = [&](int index, int px, int py) -> std::uint8_t& {
+      return pixels[(index / kAtlasCols * kCellH + py) * width + index % kAtlasCols * kCellW + px];
+    };
+    for (const auto& glyph : kFont) {
+      for (int y = 0; y < 7; ++y)
+        for (int x = 0; x < 5; ++x)
+          if (glyph.rows[y] & (0x10 >> x))
+            cell(glyph.c, x, y) = 255;
+    }
+    for (int y = 0; y < kCellH - 1; ++y)
+      for (int x = 0; x < kCellW - 1; ++x)
+        cell(kSolid, x, y) = 255;
+
+    m_atlas = GLRegistry::create(OBJ_TEXTURE, "Overlay");
+    glBindTexture(GL_TEXTURE_2D, m_atlas);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, width, height, 0, GL_RED, GL_UNSIGNED_BYTE, pixels.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    GLRegistry::setBytes(OBJ_TEXTURE, m_atlas, pixels.size());
+    FrameStats::current().bytes_uploaded += pixels.size();
+  }
+
+ public:
+  Overlay() = default;
+  Overlay(const Overlay&) = delete;
+  Overlay& operator=(const Overlay&) = delete;
+
+  ~Overlay() {
+    release();
+  }
+
+  // the shader streams in through `assets`, the overlay stays blank until then
+  void init(AssetLoader& assets, const char* vertexPath, const char* fragmentPath) {
+    assets.loadShader(m_shader, vertexPath, fragmentPath);
+    buildAtlas();
+
+    m_vao = GLRegistry::create(OBJ_VERTEX_ARRAY, "Overlay");
+    glBindVertexArray(m_vao);
+    m_vbo = GLRegistry::create(OBJ_BUFFER, "Overlay");
+    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(s_vertex),
+                          (void*)offsetof(s_vertex, position));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(s_vertex),
+                          (void*)offsetof(s_vertex, uv));
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(s_vertex),
+                          (void*)offsetof(s_vertex, color));
+    glBindVertexArray(0);
+  }
+
+  // free the GL objects, must run while the context is still current
+  void release() {
+    GLRegistry::destroy(OBJ_VERTEX_ARRAY, m_vao);
+    GLRegistry::destroy(OBJ_BUFFER, m_vbo);
+    GLRegistry::destroy(OBJ_TEXTURE, m_atlas);
+    m_capacity = 0;
+    m_shader.release();
+  }
+
+  void setVisible(bool visible) {
+    m_visible = visible;
+  }
+
+  [[nodiscard]] bool visible() const {
+    return m_visible;
+  }
+
+  // start a new batch, the previous one stays on screen until draw()
+  void clear() {
+    m_vertices.clear();
+    m_dirty = true;
+  }
+
+  void rect(float x, float y, float w, float h, const glm::vec4& color) {
+    glm::vec2 uv0, uv1;
+    cellUv(kSolid, uv0, uv1);
+    // sample the middle of the solid cell so filtering never hits its edge
+    glm::vec2 mid = (uv0 + uv1) * 0.5f;
+    quad(x, y, w, h, mid, mid, pack(color));
+  }
+
+  // returns the x coordinate after the last character
+  float text(float x, float y, std::string_view str, const glm::vec4& color) {
+    std::uint32_t packed = pack(color);
+    float w = (float)kCellW * m_scale, h = (float)kCellH * m_scale;
+    for (char c : str) {
+      if (c >= 'a' && c <= 'z')
+        c = (char)(c - 'a' + 'A');
+      if (c != ' ') {
+        glm::vec2 uv0, uv1;
+        cellUv(c, uv0, uv1);
+        quad(x, y, w, h, uv0, uv1, packed);
+      }
+      x += w;
+    }
+    return x;
+  }
+
+  [[nodiscard]] float lineHeight() const {
+    return (float)kCellH * m_scale + 2.0f;
+  }
+
+  [[nodiscard]] float charWidth() const {
+    return (float)kCellW * m_scale;
+  }
+
+  void draw(int width, int height) {
+    if (!m_visible || !m_vao || !m_shader.get())
+      return;
+    PROFILE_ZONE("Overlay::draw");
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    if (m_dirty) {
+      std::size_t bytes = m_vertices.size() * sizeof(s_vertex);
+      if (m_vertices.size() > m_capacity) {
+        m_capacity = m_vertices.size() * 2;
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(m_capacity * sizeof(s_vertex)), nullptr, GL_DYNAMIC_DRAW);
+        GLRegistry::setBytes(OBJ_BUFFER, m_vbo, m_capacity * sizeof(s_vertex));
+      }
+      glBufferSubData(GL_ARRAY_BUFFER, 0, (GLsizeiptr)bytes, m_vertices.data());
+      FrameStats::current().bytes_uploaded += bytes;
+      m_uploaded = m_vertices.size();
+      m_dirty = false;
+    }
+    if (!m_uploaded)
+      return;
+
+    GLboolean depth = glIsEnabled(GL_DEPTH_TEST);
+    glDisable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    m_shader.use();
+    m_shader.setVec2("screen", (float)width, (float)height);
+    m_shader.setInt("atlas", 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, m_atlas);
+    glBindVertexArray(m_vao);
+    glDrawArrays(GL_TRIANGLES, 0, (GLsizei)m_uploaded);
+    FrameStats::current().draw_calls++;
+    glBindVertexArray(0);
+
+    glDisable(GL_BLEND);
+    if (depth)
+      glEnable(GL_DEPTH_TEST);
+  }
+};
+}
+
+#endif // CUBE_SRC_ENGINE_OVERLAY_H_
@@ -0,0 +1,112 @@
+#ifndef CUBE_SRC_ENGINE_POSTPROCESS_H_
+#define CUBE_SRC_ENGINE_POSTPROCESS_H_
+
+#include <cstdint>
+
+#include "glad/gl.h"
+
+#include "Assets.h"
+#include "FrameStats.h"
+#include "GLRegistry.h"
+#include "Profiler.h"
+#include "RenderTarget.h"
+#include "Shader.h"
+
+namespace engine {
+// The scene drawn into an offscreen color and depth target, then copied to
+// the window by one fullscreen triangle that runs FXAA on the way. Costs a
+// target the size of the window and one full-screen pass, far less than
+// MSAA on a software rasterizer. begin() and end() bracket the scene; the
+// overlay is drawn after end(), straight into the window, and stays sharp.
+// The target may be smaller than the window, end() then upscales it with
+// bilinear filtering; a multisampled target is resolved first.
+class PostProcess {
+ protected:
+  Shader m_shader;
+  GpuZoneTimer m_timer;
+  RenderTarget m_scene;
+  RenderTarget m_resolved{"PostProcess", 0, false}; // multisampled targets only
+  GLuint m_vao = 0; // no attributes, the vertex shader makes the triangle
+
+ public:
+  // `samples` per pixel of the scene's target, 0 for none; `always` keeps
+  // the pass timed while the profiler is off, see GpuZoneTimer
+  explicit PostProcess(int samples = 0, bool always = false)
+      : m_timer("post", always), m_scene("PostProcess", samples) {}
+  PostProcess(const PostProcess&) = delete;
+  PostProcess& operator=(const PostProcess&) = delete;
+
+  ~PostProcess() {
+    release();
+  }
+
+  // The FXAA shader streams in through `assets`, until then end() copies
+  // the target to the window unfiltered. Without init() end() only copies.
+  void init(AssetLoader& assets, const char* vertexPath, const char* fragmentPath) {
+    assets.loadShader(m_shader, vertexPath, fragmentPath);
+  }
+
+  // free the GL objects, must run while the context is still current
+  void release() {
+    m_scene.release();
+    m_resolved.release();
+    GLRegistry::destroy(OBJ_VERTEX_ARRAY, m_vao);
+    m_shader.release();
+  }
+
+  // draw the scene into a `width` x `height` target from here on
+  void begin(int width, int height) {
+    if (width <= 0 || height <= 0)
+      return;
+    m_scene.resize(width, height);
+    m_scene.bind();
+  }
+
+  // filter and scale the target into a `width` x `height` window
+  void end(int width, int height) {
+    if (!m_scene.width())
+      return;
+    PROFILE_ZONE("PostProcess::end");
+    GpuZone zone(m_timer);
+    if (m_scene.samples()) {
+      m_resolved.resize(m_scene.width(), m_scene.height());
+      m_scene.resolve(m_resolved);
+    }
+    const RenderTarget& source = output();
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, width, height);
+    if (!m_shader.get()) {
+      source.blit(0, width, height);
+      return;
+    }
+
+    if (!m_vao)
+      m_vao = GLRegistry::create(OBJ_VERTEX_ARRAY, "PostProcess");
+    GLboolean depth = glIsEnabled(GL_DEPTH_TEST);
+    glDisable(GL_DEPTH_TEST);
+    m_shader.use();
+    m_shader.setInt("scene", 0);
+    m_shader.setVec2("texel", 1.0f / (float)source.width(), 1.0f / (float)source.height());
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, source.color());
+    glBindVertexArray(m_vao);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    FrameStats::current().draw_calls++;
+    glBindVertexArray(0);
+    if (depth)
+      glEnable(GL_DEPTH_TEST);
+  }
+
+  // the single-sampled scene of the last end(), before filtering and scaling
+  [[nodiscard]] const RenderTarget& output() const {
+    return m_scene.samples() ? m_resolved : m_scene;
+  }
+
+  // GPU time of the pass, see GpuZoneTimer::lastNs()
+  [[nodiscard]] std::int64_t lastNs() const {
+    return m_timer.lastNs();
+  }
+};
+}
+
+#endif // CUBE_SRC_ENGINE_POSTPROCESS_H_
@@ -0,0 +1,238 @@
+#ifndef CUBE_SRC_ENGINE_PRIMITIVES_H_
+#define CUBE_SRC_ENGINE_PRIMITIVES_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+// Mesh generators for the basic shapes. Every mesh is built in local space
+// around the origin, so one mesh serves every instance of a shape and the
+// instances are placed by their model matrices. Triangles wind counter
+// clockwise seen from outside; UVs run 0..1 across each face (boxes) or
+// around and along the surface (sphere, cylinder).
+namespace engine::primitives {
+struct s_mesh_vertex {
+  glm::vec3 position;
+  glm::vec3 normal;
+  glm::vec2 uv;
+};
+
+struct s_mesh_data {
+  std::vector<s_mesh_vertex> vertices;
+  std::vector<std::uint32_t> indices;
+};
+
+enum PrimitiveType : std::uint8_t {
+  PRIMITIVE_BOX,
+  PRIMITIVE_BEVELED_BOX,
+  PRIMITIVE_SPHERE,
+  PRIMITIVE_CYLINDER,
+  PRIMITIVE_PLANE,
+};
+
+// The parameters of one shape, also the key of MeshCache. Fields a type does
+// not use must stay at their defaults so equal shapes compare equal; the
+// make_* helpers below take care of that.
+struct s_primitive {
+  PrimitiveType type = PRIMITIVE_BOX;
+  glm::vec3 size{1.0f};      // box extents; sphere, cylinder: diameter in x, height in y; plane: x and z
+  float radius = 0.0f;       // bevel radius
+  std::uint32_t segments = 1; // bevel steps, slices around, plane cells per side
+  std::uint32_t rings = 1;    // sphere rings
+
+  bool operator==(const s_primitive&) const = default;
+};
+
+struct s_primitive_hash {
+  std::size_t operator()(const s_primitive& p) const {
+    std::size_t h = p.type;
+    auto mix = [&h](std::size_t v) { h ^= v + 0x9E3779B97F4A7C15ull + (h << 6) + (h >> 2); };
+    mix(std::hash<float>{}(p.size.x));
+    mix(std::hash<float>{}(p.size.y));
+    mix(std::hash<float>{}(p.size.z));
+    mix(std::hash<float>{}(p.radius));
+    mix(p.segments);
+    mix(p.rings);
+    return h;
+  }
+};
+
+inline s_primitive box(const glm::vec3& size) {
+  return {PRIMITIVE_BOX, size, 0.0f, 1, 1};
+}
+
+// `radius` is clamped to half the smallest extent
+inline s_primitive beveled_box(const glm::vec3& size, float radius, std::uint32_t segments = 4) {
+  float r = std::clamp(radius, 0.0f, std::min({size.x, size.y, size.z}) / 2.0f);
+  return {PRIMITIVE_BEVELED_BOX, size, r, std::max(segments, 1u), 1};
+}
+
+inline s_primitive sphere(float diameter, std::uint32_t segments = 32, std::uint32_t rings = 16) {
+  return {PRIMITIVE_SPHERE, glm::vec3(diameter), 0.0f, std::max(segments, 3u), std::max(rings, 2u)};
+}
+
+inline s_primitive cylinder(float diameter, float height, std::uint32_t segments = 32) {
+  return {PRIMITIVE_CYLINDER, {diameter, height, diameter}, 0.0f, std::max(segments, 3u), 1};
+}
+
+// in the xz plane, facing +y
+inline s_primitive plane(const glm::vec2& size, std::uint32_t cells = 1) {
+  return {PRIMITIVE_PLANE, {size.x, 0.0f, size.y}, 0.0f, std::max(cells, 1u), 1};
+}
+
+// Append a (columns + 1) x (rows + 1) vertex grid as quads, `vertex(x, y)`
+// giving the vertex of column x and row y; x runs to the right and y up
+// when the grid is seen from the front.
+template <typename F>
+void append_grid(s_mesh_data& mesh, std::uint32_t columns, std::uint32_t rows, F&& vertex) {
+  auto first = (std::uint32_t)mesh.vertices.size();
+  for (std::uint32_t y = 0; y <= rows; ++y)
+    for (std::uint32_t x = 0; x <= columns; ++x)
+      mesh.vertices.push_back(vertex(x, y));
+  for (std::uint32_t y = 0; y < rows; ++y) {
+    for (std::uint32_t x = 0; x < columns; ++x) {
+      std::uint32_t a = first + y * (columns + 1) + x;
+      std::uint32_t b = a + 1, c = a + columns + 1, d = c + 1;
+      mesh.indices.insert(mesh.indices.end(), {a, b, d, d, c, a});
+    }
+  }
+}
+
+// The six faces of a box with half extents `half`, each a grid whose rows
+// sit at `steps[axis]` (ascending, from -half to half) along its two face
+// axes. `place` turns a point on the box surface and its face normal into
+// the final vertex.
+template <typename F>
+void append_box_faces(s_mesh_data& mesh, const glm::vec3& half, const std::vector<float> (&steps)[3], F&& place) {
+  // normal, right and up of each face, seen from outside, as axis and sign
+  const int faces[6][3][2] = {
+      {{2, 1}, {0, 1}, {1, 1}},  {{0, 1}, {2, -1}, {1, 1}}, {{2, -1}, {0, -1}, {1, 1}},
+      {{0, -1}, {2, 1}, {1, 1}}, {{1, 1}, {0, 1}, {2, -1}}, {{1, -1}, {0, 1}, {2, 1}},
+  };
+  for (const auto& face : faces) {
+    const auto& [n, right, up] = face;
+    const std::vector<float>& columns = steps[right[0]];
+    const std::vector<float>& rows = steps[up[0]];
+    append_grid(mesh, (std::uint32_t)columns.size() - 1, (std::uint32_t)rows.size() - 1,
+                [&](std::uint32_t x, std::uint32_t y) {
+                  glm::vec3 p(0.0f), normal(0.0f);
+                  p[n[0]] = half[n[0]] * (float)n[1];
+                  p[right[0]] = columns[x] * (float)right[1];
+                  p[up[0]] = rows[y] * (float)up[1];
+                  normal[n[0]] = (float)n[1];
+                  s_mesh_vertex v = place(p, normal);
+                  v.uv = {(columns[x] / half[right[0]] + 1.0f) / 2.0f, (rows[y] / half[up[0]] + 1.0f) / 2.0f};
+                  return v;
+                });
+  }
+}
+
+inline s_mesh_data make_box(const glm::vec3& size) {
+  s_mesh_data mesh;
+  glm::vec3 half = size / 2.0f;
+  const std::vector<float> steps[3] = {{-half.x, half.x}, {-half.y, half.y}, {-half.z, half.z}};
+  append_box_faces(mesh, half, steps, [](const glm::vec3& p, const glm::vec3& normal) {
+    return s_mesh_vertex{p, normal, {}};
+  });
+  return mesh;
+}
+
+// A box whose edges and corners are rounded with `radius`. Each face gets
+// `segments` rows inside every border as wide as the radius; a point of the
+// box surface is moved onto the rounded surface along the direction from
+// the nearest point of the inner box (the box shrunk by the radius). Each
+// face so covers half of every bevel, meeting its neighbour at 45 degrees.
+inline s_mesh_data make_beveled_box(const glm::vec3& size, float radius, std::uint32_t segments) {
+  s_mesh_data mesh;
+  glm::vec3 half = size / 2.0f;
+  glm::vec3 inner = half - radius;
+  std::vector<float> steps[3];
+  for (int a = 0; a < 3; ++a) {
+    for (std::uint32_t i = 0; i <= segments; ++i)
+      steps[a].push_back(-half[a] + radius * (float)i / (float)segments);
+    for (std::uint32_t i = 0; i <= segments; ++i)
+      steps[a].push_back(inner[a] + radius * (float)i / (float)segments);
+    if (radius <= 0.0f)
+      steps[a] = {-half[a], half[a]};
+  }
+  append_box_faces(mesh, half, steps, [&](const glm::vec3& p, const glm::vec3& normal) {
+    glm::vec3 core = glm::clamp(p, -inner, inner);
+    glm::vec3 out = p - core;
+    glm::vec3 n = glm::dot(out, out) > 1e-12f ? glm::normalize(out) : normal;
+    return s_mesh_vertex{core + n * radius, n, {}};
+  });
+  return mesh;
+}
+
+inline s_mesh_data make_sphere(float radius, std::uint32_t segments, std::uint32_t rings) {
+  s_mesh_data mesh;
+  // the seam column is doubled so the u coordinate can wrap
+  append_grid(mesh, segments, rings, [&](std::uint32_t x, std::uint32_t y) {
+    float u = (float)x / (float)segments, v = (float)y / (float)rings;
+    float phi = u * 6.2831853f, theta = (1.0f - v) * 3.1415927f; // from the north pole down
+    glm::vec3 n(std::sin(theta) * std::sin(phi), std::cos(theta), std::sin(theta) * std::cos(phi));
+    return s_mesh_vertex{n * radius, n, {u, v}};
+  });
+  return mesh;
+}
+
+inline s_mesh_data make_cylinder(float radius, float height, std::uint32_t segments) {
+  s_mesh_data mesh;
+  float half = height / 2.0f;
+  append_grid(mesh, segments, 1, [&](std::uint32_t x, std::uint32_t y) {
+    float u = (float)x / (float)segments;
+    glm::vec3 n(std::sin(u * 6.2831853f), 0.0f, std::cos(u * 6.2831853f));
+    return s_mesh_vertex{n * radius + glm::vec3(0.0f, y ? half : -half, 0.0f), n, {u, (float)y}};
+  });
+  // caps: a center vertex and a fan around it
+  for (float side : {1.0f, -1.0f}) {
+    auto center = (std::uint32_t)mesh.vertices.size();
+    glm::vec3 n(0.0f, side, 0.0f);
+    mesh.vertices.push_back({n * half, n, {0.5f, 0.5f}});
+    for (std::uint32_t i = 0; i <= segments; ++i) {
+      float a = (float)i / (float)segments * 6.2831853f;
+      glm::vec2 c(std::sin(a), std::cos(a));
+      mesh.vertices.push_back({{c.x * radius, side * half, c.y * radius}, n, c * 0.5f + 0.5f});
+    }
+    for (std::uint32_t i = 0; i < segments; ++i) {
+      std::uint32_t a = center + 1 + i, b = a + 1;
+      if (side > 0.0f)
+        mesh.indices.insert(mesh.indices.end(), {center, a, b});
+      else
+        mesh.indices.insert(mesh.indices.end(), {center, b, a});
+    }
+  }
+  return mesh;
+}
+
+inline s_mesh_data make_plane(const glm::vec2& size, std::uint32_t cells) {
+  s_mesh_data mesh;
+  append_grid(mesh, cells, cells, [&](std::uint32_t x, std::uint32_t y) {
+    glm::vec2 uv((float)x / (float)cells, (float)y / (float)cells);
+    return s_mesh_vertex{{(uv.x - 0.5f) * size.x, 0.0f, (0.5f - uv.y) * size.y}, {0.0f, 1.0f, 0.0f}, uv};
+  });
+  return mesh;
+}
+
+inline s_mesh_data make_mesh(const s_primitive& p) {
+  switch (p.type) {
+    case PRIMITIVE_BEVELED_BOX:
+      return make_beveled_box(p.size, p.radius, p.segments);
+    case PRIMITIVE_SPHERE:
+      return make_sphere(p.size.x / 2.0f, p.segments, p.rings);
+    case PRIMITIVE_CYLINDER:
+      return make_cylinder(p.size.x / 2.0f, p.size.y, p.segments);
+    case PRIMITIVE_PLANE:
+      return make_plane({p.size.x, p.size.z}, p.segments);
+    case PRIMITIVE_BOX:
+    default:
+      return make_box(p.size);
+  }
+}
+}
+
+#endif // CUBE_SRC_ENGINE_PRIMITIVES_H_
@@ -0,0 +1,320 @@
+#ifndef CUBE_SRC_ENGINE_PROFILER_H_
+#define CUBE_SRC_ENGINE_PROFILER_H_
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "glad/gl.h"
+
+#include "GLRegistry.h"
+#include "Input.h"
+
+// Scoped CPU/GPU zones. Define CUBE_PROFILER to compile them in; at runtime
+// they stay disabled (one relaxed load and a branch) until enabled.
+//   PROFILE_ZONE("name")      CPU time of the enclosing scope
+//   PROFILE_FUNCTION()        same, named after the function
+//   PROFILE_GPU_ZONE("name")  GPU time of the GL commands issued in the scope,
+//                             render thread only, must not nest
+#define CUBE_PROFILE_CONCAT_(a, b) a##b
+#define CUBE_PROFILE_CONCAT(a, b) CUBE_PROFILE_CONCAT_(a, b)
+
+#ifdef CUBE_PROFILER
+#define PROFILE_ZONE(name) \
+  engine::ProfileZone CUBE_PROFILE_CONCAT(_profile_zone_, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_ZONE(__func__)
+#define PROFILE_GPU_ZONE(name) \
+  static engine::GpuZoneTimer CUBE_PROFILE_CONCAT(_gpu_timer_, __LINE__)(name); \
+  engine::GpuZone CUBE_PROFILE_CONCAT(_gpu_zone_, __LINE__)(CUBE_PROFILE_CONCAT(_gpu_timer_, __LINE__))
+#else
+#define PROFILE_ZONE(name) ((void)0)
+#define PROFILE_FUNCTION() ((void)0)
+#define PROFILE_GPU_ZONE(name) ((void)0)
+#endif
+
+namespace engine {
+struct s_profile_event {
+  const char* name = nullptr; // must have static storage duration
+  std::int64_t start_ns = 0;
+  std::int64_t duration_ns = 0;
+};
+
+// Ring of the most recent zones of one thread. Only the owning thread
+// writes; readers copy entries and then re-check the write index to drop
+// the ones that might have been overwritten meanwhile.
+class ProfileRing {
+ public:
+  static constexpr std::size_t kCapacity = 1 << 16;
+
+ protected:
+  std::vector<s_profile_event> m_events = std::vector<s_profile_event>(kCapacity);
+  std::atomic<std::uint64_t> m_written{0};
+  std::string m_name;
+  int m_tid;
+
+ public:
+  ProfileRing(std::string name, int tid) : m_name(std::move(name)), m_tid(tid) {}
+
+  void push(const s_profile_event& event) {
+    std::uint64_t at = m_written.load(std::memory_order_relaxed);
+    m_events[at % kCapacity] = event;
+    m_written.store(at + 1, std::memory_order_release);
+  }
+
+  // append every event that started at or after `since_ns`
+  void collect(std::int64_t since_ns, std::vector<s_profile_event>& out) const {
+    std::uint64_t end = m_written.load(std::memory_order_acquire);
+    std::uint64_t begin = end > kCapacity ? end - kCapacity : 0;
+    std::vector<s_profile_event> copy(m_events.begin(), m_events.end());
+
+    // slots the writer lapped while we were copying may be torn, and so
+    // may slot `now`, which a push in flight writes before bumping the index
+    std::uint64_t now = m_written.load(std::memory_order_acquire);
+    std::uint64_t safe = now + 1 > kCapacity ? now + 1 - kCapacity : 0;
+    for (std::uint64_t i = std::max(begin, safe); i < end; ++i) {
+      const s_profile_event& event = copy[i % kCapacity];
+      if (event.start_ns >= since_ns)
+        out.push_back(event);
+    }
+  }
+
+  void setName(std::string name) {
+    m_name = std::move(name);
+  }
+
+  [[nodiscard]] const std::string& name() const {
+    return m_name;
+  }
+
+  [[nodiscard]] int tid() const {
+    return m_tid;
+  }
+};
+
+class GpuZoneTimer;
+
+class Profiler {
+ protected:
+  static inline std::atomic<bool> s_enabled{false};
+  static inline std::mutex s_mutex; // registration and dumping only
+  static inline std::vector<std::unique_ptr<ProfileRing>> s_rings;
+  static inline std::vector<GpuZoneTimer*> s_gpuTimers;
+  static inline ProfileRing* s_gpuRing = nullptr;
+
+  static ProfileRing* registerRing(const std::string& name) {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    int tid = (int)s_rings.size() + 1;
+    s_rings.push_back(std::make_unique<ProfileRing>(name, tid));
+    return s_rings.back().get();
+  }
+
+  static void writeEscaped(std::ostream& out, const std::string& text) {
+    for (char c : text) {
+      if (c == '"' || c == '\\')
+        out << '\\';
+      out << c;
+    }
+  }
+
+ public:
+  static bool enabled() {
+    return s_enabled.load(std::memory_order_relaxed);
+  }
+
+  static void setEnabled(bool enabled) {
+    s_enabled.store(enabled, std::memory_order_relaxed);
+  }
+
+  // the calling thread's ring, created on first use
+  static ProfileRing& threadRing() {
+    thread_local ProfileRing* ring = registerRing("thread");
+    return *ring;
+  }
+
+  static void setThreadName(const char* name) {
+    ProfileRing& ring = threadRing();
+    std::lock_guard<std::mutex> lock(s_mutex);
+    ring.setName(name);
+  }
+
+  // GPU zones are shown as their own track in the trace
+  static ProfileRing& gpuRing() {
+    if (!s_gpuRing)
+      s_gpuRing = registerRing("GPU");
+    return *s_gpuRing;
+  }
+
+  static void addGpuTimer(GpuZoneTimer* timer) {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    s_gpuTimers.push_back(timer);
+  }
+
+  static void releaseGpu();
+
+  // Chrome trace JSON (chrome://tracing, Perfetto, Speedscope) of the last
+  // `seconds` of every thread
+  static bool writeChromeTrace(const char* path, double seconds) {
+    std::int64_t since = now_ns() - (std::int64_t)(seconds * 1e9);
+    std::ofstream out(path, std::ios::trunc);
+    if (!out) {
+      std::cerr << "ERROR::PROFILER::TRACE_NOT_WRITTEN " << path << std::endl;
+      return false;
+    }
+
+    // microseconds since the start of the window with ns resolution; raw
+    // now_ns() counts from boot and would lose the digits that matter
+    out << std::fixed << std::setprecision(3);
+    std::lock_guard<std::mutex> lock(s_mutex);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    std::vector<s_profile_event> events;
+    for (auto& ring : s_rings) {
+      out << (first ? "" : ",\n") << R"({"name":"thread_name","ph":"M","pid":1,"tid":)"
+          << ring->tid() << R"(,"args":{"name":")";
+      writeEscaped(out, ring->name());
+      out << "\"}}";
+      first = false;
+
+      events.clear();
+      ring->collect(since, events);
+      for (auto& event : events) {
+        out << ",\n{\"name\":\"";
+        writeEscaped(out, event.name);
+        out << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << ring->tid()
+            << ",\"ts\":" << (double)(event.start_ns - since) / 1e3
+            << ",\"dur\":" << (double)event.duration_ns / 1e3 << '}';
+      }
+    }
+    out << "\n]}\n";
+    return true;
+  }
+};
+
+class ProfileZone {
+ protected:
+  const char* m_name;
+  std::int64_t m_start = 0;
+
+ public:
+  explicit ProfileZone(const char* name) : m_name(name) {
+    if (Profiler::enabled())
+      m_start = now_ns();
+  }
+
+  ~ProfileZone() {
+    if (m_start)
+      Profiler::threadRing().push({m_name, m_start, now_ns() - m_start});
+  }
+
+  ProfileZone(const ProfileZone&) = delete;
+  ProfileZone& operator=(const ProfileZone&) = delete;
+};
+
+// GL_TIME_ELAPSED timer for one pass. Two queries alternate between frames
+// and a result is only read once GL reports it available, so the CPU never
+// waits on the GPU; a sample that is not ready in time is dropped. The GPU
+// event is placed at the CPU time the pass was submitted.
+// An `always` timer also runs while the profiler is off, for callers that
+// only read lastNs().
+class GpuZoneTimer {
+ protected:
+  const char* m_name;
+  bool m_always = false;
+  std::int64_t m_lastNs = 0;
+  std::array<GLuint, 2> m_queries{};
+  std::array<std::int64_t, 2> m_submitted{};
+  std::array<bool, 2> m_pending{};
+  int m_slot = 0;
+  bool m_active = false;
+
+  void resolve(int slot) {
+    if (!m_pending[slot])
+      return;
+    GLint available = 0;
+    glGetQueryObjectiv(m_queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+    m_pending[slot] = false; // reused now either way
+    if (!available)
+      return;
+    GLuint64 elapsed = 0;
+    glGetQueryObjectui64v(m_queries[slot], GL_QUERY_RESULT, &elapsed);
+    m_lastNs = (std::int64_t)elapsed;
+    if (Profiler::enabled())
+      Profiler::gpuRing().push({m_name, m_submitted[slot], m_lastNs});
+  }
+
+ public:
+  explicit GpuZoneTimer(const char* name, bool always = false) : m_name(name), m_always(always) {}
+
+  GpuZoneTimer(const GpuZoneTimer&) = delete;
+  GpuZoneTimer& operator=(const GpuZoneTimer&) = delete;
+
+  void begin() {
+    if (!m_always && !Profiler::enabled())
+      return;
+    if (!m_queries[0]) {
+      for (auto& query : m_queries)
+        query = GLRegistry::create(OBJ_QUERY, m_name);
+      Profiler::addGpuTimer(this);
+    }
+    resolve(m_slot);
+    m_submitted[m_slot] = now_ns();
+    glBeginQuery(GL_TIME_ELAPSED, m_queries[m_slot]);
+    m_active = true;
+  }
+
+  void end() {
+    if (!m_active)
+      return;
+    glEndQuery(GL_TIME_ELAPSED);
+    m_pending[m_slot] = true;
+    m_slot ^= 1;
+    m_active = false;
+  }
+
+  // GPU time of the most recent sample that has been read back
+  [[nodiscard]] std::int64_t lastNs() const {
+    return m_lastNs;
+  }
+
+  void release() {
+    for (auto& query : m_queries)
+      GLRegistry::destroy(OBJ_QUERY, query);
+    m_pending = {};
+  }
+};
+
+class GpuZone {
+ protected:
+  GpuZoneTimer& m_timer;
+
+ public:
+  explicit GpuZone(GpuZoneTimer& timer) : m_timer(timer) {
+    m_timer.begin();
+  }
+
+  ~GpuZone() {
+    m_timer.end();
+  }
+
+  GpuZone(const GpuZone&) = delete;
+  GpuZone& operator=(const GpuZone&) = delete;
+};
+
+// free the GPU timer queries, must run while the context is still current
+inline void Profiler::releaseGpu() {
+  std::lock_guard<std::mutex> lock(s_mutex);
+  for (auto* timer : s_gpuTimers)
+    timer->release();
+  s_gpuTimers.clear();
+}
+}
+
+#endif // CUBE_SRC_ENGINE_PROFILER_H_
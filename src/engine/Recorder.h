@@ -0,0 +1,221 @@
+#ifndef CUBE_SRC_ENGINE_RECORDER_H_
+#define CUBE_SRC_ENGINE_RECORDER_H_
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <vector>
+
+#include "Input.h"
+
+namespace engine {
+// Session log layout:
+//   header  "RBKR" | u16 version | u16 tick rate (Hz)
+//   record  u8 type | varint tick delta | payload
+//     REC_EVENT  u16 key | u8 action | u8 mods
+//     REC_END    u64 state checksum
+// Ticks are delta coded against the previous record, so a typical event
+// takes 5-6 bytes.
+enum RecordType : std::uint8_t {
+  REC_EVENT = 0,
+  REC_END = 1,
+};
+
+struct s_record {
+  RecordType type = REC_EVENT;
+  std::uint64_t tick = 0;
+  s_input_event event;
+  std::uint64_t checksum = 0;
+};
+
+constexpr char kSessionMagic[4] = {'R', 'B', 'K', 'R'};
+constexpr std::uint16_t kSessionVersion = 1;
+
+class SessionRecorder {
+ protected:
+  std::ofstream m_file;
+  std::uint64_t m_lastTick = 0;
+  std::uint64_t m_events = 0;
+
+  void writeU8(std::uint8_t v) {
+    m_file.put((char)v);
+  }
+
+  void writeU16(std::uint16_t v) {
+    writeU8((std::uint8_t)(v & 0xff));
+    writeU8((std::uint8_t)(v >> 8));
+  }
+
+  void writeVarint(std::uint64_t v) {
+    while (v >= 0x80) {
+      writeU8((std::uint8_t)(v | 0x80));
+      v >>= 7;
+    }
+    writeU8((std::uint8_t)v);
+  }
+
+  void writeTick(std::uint64_t tick) {
+    writeVarint(tick - m_lastTick);
+    m_lastTick = tick;
+  }
+
+ public:
+  SessionRecorder() = default;
+
+  ~SessionRecorder() {
+    if (m_file.is_open())
+      m_file.close();
+  }
+
+  bool open(const char* path, std::uint16_t tickRate) {
+    m_file.open(path, std::ios::binary | std::ios::trunc);
+    if (!m_file) {
+      std::cerr << "ERROR::RECORDER::FILE_NOT_OPENED " << path << std::endl;
+      return false;
+    }
+    m_file.write(kSessionMagic, sizeof(kSessionMagic));
+    writeU16(kSessionVersion);
+    writeU16(tickRate);
+    return true;
+  }
+
+  [[nodiscard]] bool isOpen() const {
+    return m_file.is_open();
+  }
+
+  void record(std::uint64_t tick, const s_input_event& event) {
+    if (!m_file.is_open())
+      return;
+    writeU8(REC_EVENT);
+    writeTick(tick);
+    writeU16((std::uint16_t)event.key);
+    writeU8((std::uint8_t)event.action);
+    writeU8((std::uint8_t)event.mods);
+    m_events++;
+  }
+
+  // close the log with the final tick and a checksum of the simulation state
+  void finish(std::uint64_t tick, std::uint64_t checksum) {
+    if (!m_file.is_open())
+      return;
+    writeU8(REC_END);
+    writeTick(tick);
+    for (int i = 0; i < 8; ++i)
+      writeU8((std::uint8_t)(checksum >> (i * 8)));
+    m_file.close();
+  }
+
+  [[nodiscard]] std::uint64_t events() const {
+    return m_events;
+  }
+};
+
+class SessionReplay {
+ protected:
+  std::vector<s_record> m_records;
+  std::size_t m_next = 0;
+  std::uint16_t m_tickRate = 0;
+
+ public:
+  bool open(const char* path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+      std::cerr << "ERROR::REPLAY::FILE_NOT_OPENED " << path << std::endl;
+      return false;
+    }
+    std::vector<std::uint8_t> data((std::istreambuf_iterator<char>(file)),
+                                   std::istreambuf_iterator<char>());
+
+    std::size_t at = 0;
+    auto u8 = [&]() -> std::uint8_t {
+      return at < data.size() ? data[at++] : 0;
+    };
+    auto u16 = [&]() -> std::uint16_t {
+      std::uint16_t lo = u8();
+      return (std::uint16_t)(lo | (std::uint16_t)(u8() << 8));
+    };
+    auto varint = [&]() -> std::uint64_t {
+      std::uint64_t v = 0;
+      for (int shift = 0; at < data.size() && shift < 64; shift += 7) {
+        std::uint8_t b = u8();
+        v |= (std::uint64_t)(b & 0x7f) << shift;
+        if (!(b & 0x80))
+          break;
+      }
+      return v;
+    };
+
+    if (data.size() < 8 || std::memcmp(data.data(), kSessionMagic, sizeof(kSessionMagic)) != 0) {
+      std::cerr << "ERROR::REPLAY::BAD_HEADER " << path << std::endl;
+      return false;
+    }
+    at = sizeof(kSessionMagic);
+    if (u16() != kSessionVersion) {
+      std::cerr << "ERROR::REPLAY::UNSUPPORTED_VERSION " << path << std::endl;
+      return false;
+    }
+    m_tickRate = u16();
+
+    std::uint64_t tick = 0;
+    m_records.clear();
+    while (at < data.size()) {
+      s_record rec;
+      rec.type = (RecordType)u8();
+      tick += varint();
+      rec.tick = tick;
+      if (rec.type == REC_EVENT) {
+        rec.event.key = (std::int16_t)u16();
+        rec.event.action = u8();
+        rec.event.mods = u8();
+      } else if (rec.type == REC_END) {
+        for (int i = 0; i < 8; ++i)
+          rec.checksum |= (std::uint64_t)u8() << (i * 8);
+      } else {
+        std::cerr << "ERROR::REPLAY::BAD_RECORD at byte " << at << std::endl;
+        return false;
+      }
+      m_records.push_back(rec);
+    }
+    m_next = 0;
+    return true;
+  }
+
+  // next event scheduled at or before `tick`, stamped with the current time
+  bool poll(std::uint64_t tick, s_input_event& event) {
+    if (m_next >= m_records.size() || m_records[m_next].tick > tick ||
+        m_records[m_next].type != REC_EVENT)
+      return false;
+    event = m_records[m_next++].event;
+    event.time_ns = now_ns();
+    return true;
+  }
+
+  // true once every event was handed out and the recorded end tick is reached
+  [[nodiscard]] bool done(std::uint64_t tick) const {
+    if (m_next >= m_records.size())
+      return true;
+    return m_records[m_next].type == REC_END && tick >= m_records[m_next].tick;
+  }
+
+  // false when the recording session was not closed cleanly
+  [[nodiscard]] bool hasEnd() const {
+    return !m_records.empty() && m_records.back().type == REC_END;
+  }
+
+  [[nodiscard]] std::uint64_t checksum() const {
+    return hasEnd() ? m_records.back().checksum : 0;
+  }
+
+  [[nodiscard]] std::uint16_t tickRate() const {
+    return m_tickRate;
+  }
+
+  [[nodiscard]] std::size_t size() const {
+    return m_records.size();
+  }
+};
+}
+
+#endif // CUBE_SRC_ENGINE_RECORDER_H_
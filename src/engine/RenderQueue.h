@@ -0,0 +1,214 @@
+#ifndef CUBE_SRC_ENGINE_RENDERQUEUE_H_
+#define CUBE_SRC_ENGINE_RENDERQUEUE_H_
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+#include "FrameStats.h"
+#include "Memory.h"
+#include "MeshCache.h"
+#include "Profiler.h"
+#include "Shader.h"
+#include "StaticBatch.h"
+
+namespace engine {
+enum RenderPass : std::uint8_t {
+  PASS_OPAQUE = 0,
+  PASS_TRANSLUCENT = 1,
+};
+
+// 64-bit sort key, most significant field first:
+//   pass 4 | program 12 | material 12 | depth 20 | mesh 16
+// Sorted keys group the commands by pass, then program and material, so
+// each is bound once. Cubies share one cached mesh behind one VAO, so
+// grouping by mesh saves nothing; depth comes first instead and opaque
+// commands run front to back for early depth rejection, translucent ones
+// back to front.
+struct RenderKey {
+  static constexpr int kMeshShift = 0;
+  static constexpr int kDepthShift = 16;
+  static constexpr int kMaterialShift = 36;
+  static constexpr int kProgramShift = 48;
+  static constexpr int kPassShift = 60;
+
+  // `depth` is the view space distance; the bits of a positive float sort
+  // like the float, the top 20 of them keep 12 mantissa bits of precision
+  static std::uint64_t make(RenderPass pass, std::uint32_t program, std::uint32_t material,
+                            float depth, std::uint32_t mesh) {
+    auto bits = std::bit_cast<std::uint32_t>(depth > 0.0f ? depth : 0.0f);
+    std::uint64_t d = (bits >> 11) & 0xFFFFF;
+    if (pass == PASS_TRANSLUCENT)
+      d = 0xFFFFF - d;
+    return (std::uint64_t)(pass & 0xF) << kPassShift | (std::uint64_t)(program & 0xFFF) << kProgramShift |
+           (std::uint64_t)(material & 0xFFF) << kMaterialShift | d << kDepthShift |
+           (std::uint64_t)(mesh & 0xFFFF) << kMeshShift;
+  }
+
+  static std::uint32_t program(std::uint64_t key) {
+    return (std::uint32_t)(key >> kProgramShift) & 0xFFF;
+  }
+};
+
+struct s_draw_command {
+  std::uint64_t key = 0;
+  const Shader* shader = nullptr;
+  StaticBatch* batch = nullptr;
+  const glm::mat4* model = nullptr; // must stay valid until submit()
+  // a box of the cache, drawn instead of `batch` when set: `shape` is its
+  // id, `colors` its six face colors and `faces` the CubeFace mask shown
+  MeshCache* cache = nullptr;
+  std::uint32_t shape = 0;
+  const glm::vec3* colors = nullptr; // must stay valid until submit()
+  std::uint8_t faces = 0x3F;
+};
+
+// Draw commands collected over a frame, radix sorted by key and submitted in
+// one go. Each producer thread appends to its own list without locking; the
+// caller makes sure every producer is done before sort() runs on the render
+// thread. The lists keep their capacity, so steady frames do not allocate.
+class RenderQueue {
+ protected:
+  struct s_sort_item {
+    std::uint64_t key;
+    std::uint32_t producer;
+    std::uint32_t index;
+  };
+
+  // padded so producers on different cores do not share cache lines
+  struct alignas(64) s_producer {
+    std::vector<s_draw_command> commands;
+  };
+
+  std::vector<s_producer> m_producers;
+  s_sort_item* m_sorted = nullptr; // in the frame arena of the sorting thread
+  std::size_t m_count = 0;
+
+  std::size_t m_lastCommands = 0;
+  std::size_t m_lastPrograms = 0;
+
+  // LSD radix sort on 8-bit digits; digits every key shares are skipped,
+  // which drops most passes since pass and program rarely differ
+  static s_sort_item* radixSort(s_sort_item* items, s_sort_item* scratch, std::size_t count) {
+    std::array<std::array<std::uint32_t, 256>, 8> histograms{};
+    for (std::size_t i = 0; i < count; ++i)
+      for (int digit = 0; digit < 8; ++digit)
+        histograms[digit][(items[i].key >> (digit * 8)) & 0xFF]++;
+
+    for (int digit = 0; digit < 8; ++digit) {
+      auto& histogram = histograms[digit];
+      if (histogram[(items[0].key >> (digit * 8)) & 0xFF] == count)
+        continue;
+      std::uint32_t offset = 0;
+      for (auto& bucket : histogram) {
+        std::uint32_t n = bucket;
+        bucket = offset;
+        offset += n;
+      }
+      for (std::size_t i = 0; i < count; ++i)
+        scratch[histogram[(items[i].key >> (digit * 8)) & 0xFF]++] = items[i];
+      std::swap(items, scratch);
+    }
+    return items;
+  }
+
+ public:
+  // one producer per thread that pushes, e.g. JobSystem::slots()
+  explicit RenderQueue(std::size_t producers = 1) : m_producers(std::max<std::size_t>(producers, 1)) {}
+
+  void push(std::size_t producer, const s_draw_command& command) {
+    m_producers[producer].commands.push_back(command);
+  }
+
+  // order every command pushed since the last clear()
+  std::size_t sort(FrameArena& arena = FrameArena::thread()) {
+    PROFILE_ZONE("RenderQueue::sort");
+    m_count = 0;
+    for (const auto& producer : m_producers)
+      m_count += producer.commands.size();
+    if (!m_count) {
+      m_sorted = nullptr;
+      return 0;
+    }
+    auto* items = arena.allocate<s_sort_item>(m_count);
+    auto* scratch = arena.allocate<s_sort_item>(m_count);
+    std::size_t n = 0;
+    for (std::uint32_t p = 0; p < m_producers.size(); ++p) {
+      const auto& commands = m_producers[p].commands;
+      for (std::uint32_t i = 0; i < commands.size(); ++i)
+        items[n++] = {commands[i].key, p, i};
+    }
+    m_sorted = radixSort(items, scratch, m_count);
+    return m_count;
+  }
+
+  // issue the sorted commands; view and projection are set once per
+  // program, a cache's VAO is bound once per run of its boxes
+  void submit(const glm::mat4& view, const glm::mat4& projection) {
+    PROFILE_ZONE("RenderQueue::submit");
+    const Shader* bound = nullptr;
+    MeshCache* boundCache = nullptr;
+    m_lastPrograms = 0;
+    for (std::size_t i = 0; i < m_count; ++i) {
+      const s_draw_command& command = m_producers[m_sorted[i].producer].commands[m_sorted[i].index];
+      if (command.shader != bound) {
+        bound = command.shader;
+        bound->use();
+        bound->setMat4("view", view);
+        bound->setMat4("projection", projection);
+        m_lastPrograms++;
+      } else {
+        FrameStats::current().gl_calls_elided += 3;
+      }
+      bound->setMat4("model", *command.model);
+      if (command.cache) {
+        if (command.cache != boundCache) {
+          boundCache = command.cache;
+          boundCache->bind();
+        }
+        bound->setVec3("faceColors", command.colors, 6);
+        bound->setInt("faces", command.faces);
+        boundCache->draw(command.shape);
+        continue;
+      }
+      // per-vertex colors, and the draw binds a VAO of its own
+      boundCache = nullptr;
+      bound->setInt("faces", 0);
+      command.batch->draw();
+    }
+    if (boundCache)
+      glBindVertexArray(0);
+    m_lastCommands = m_count;
+  }
+
+  void clear() {
+    for (auto& producer : m_producers)
+      producer.commands.clear();
+    m_sorted = nullptr;
+    m_count = 0;
+  }
+
+  // sorted order, valid between sort() and clear()
+  [[nodiscard]] const s_draw_command& sorted(std::size_t i) const {
+    return m_producers[m_sorted[i].producer].commands[m_sorted[i].index];
+  }
+
+  [[nodiscard]] std::size_t size() const {
+    return m_count;
+  }
+
+  [[nodiscard]] std::size_t lastCommands() const {
+    return m_lastCommands;
+  }
+
+  [[nodiscard]] std::size_t lastPrograms() const {
+    return m_lastPrograms;
+  }
+};
+}
+
+#endif // CUBE_SRC_ENGINE_RENDERQUEUE_H_
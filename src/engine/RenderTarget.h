@@ -0,0 +1,267 @@
+#ifndef CUBE_SRC_ENGINE_RENDERTARGET_H_
+#define CUBE_SRC_ENGINE_RENDERTARGET_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+
+#include "glad/gl.h"
+
+#include "GLRegistry.h"
+#include "Profiler.h"
+
+namespace engine {
+// A framebuffer with an RGBA8 color and a 24 bit depth attachment, both
+// textures so the color can be sampled by a later pass. A multisampled
+// target cannot be sampled or read back; resolve() it into a plain one.
+class RenderTarget {
+ protected:
+  const char* m_owner; // registry owner of the GL objects
+  GLuint m_fbo = 0, m_color = 0, m_depth = 0;
+  int m_width = 0, m_height = 0;
+  int m_samples = 0;
+  bool m_hasDepth = true;
+
+  static void filtered(GLuint texture, GLint filter) {
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  }
+
+  void allocate(GLuint texture, GLenum format, GLenum pixelFormat, GLenum type, GLint filter) {
+    if (m_samples) {
+      glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, texture);
+      glTexImage2DMultisample(GL_TEXTURE_2D_MULTISAMPLE, m_samples, format, m_width, m_height, GL_TRUE);
+      glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, 0);
+    } else {
+      glBindTexture(GL_TEXTURE_2D, texture);
+      glTexImage2D(GL_TEXTURE_2D, 0, (GLint)format, m_width, m_height, 0, pixelFormat, type, nullptr);
+      filtered(texture, filter);
+      glBindTexture(GL_TEXTURE_2D, 0);
+    }
+    GLRegistry::setBytes(OBJ_TEXTURE, texture, (std::size_t)m_width * m_height * 4 * (m_samples ? m_samples : 1));
+  }
+
+ public:
+  // `samples` per pixel, 0 for none; `depth` false for a color-only target,
+  // e.g. the one a multisampled target is resolved into
+  explicit RenderTarget(const char* owner, int samples = 0, bool depth = true)
+      : m_owner(owner), m_samples(samples), m_hasDepth(depth) {}
+  RenderTarget(const RenderTarget&) = delete;
+  RenderTarget& operator=(const RenderTarget&) = delete;
+
+  ~RenderTarget() {
+    release();
+  }
+
+  // (re)allocate the attachments, nothing happens when the size is unchanged
+  void resize(int width, int height) {
+    if (width == m_width && height == m_height)
+      return;
+    if (!m_fbo) {
+      m_fbo = GLRegistry::create(OBJ_FRAMEBUFFER, m_owner);
+      m_color = GLRegistry::create(OBJ_TEXTURE, m_owner);
+      if (m_hasDepth)
+        m_depth = GLRegistry::create(OBJ_TEXTURE, m_owner);
+    }
+    m_width = width;
+    m_height = height;
+    // linear, so passes sampling between texels (FXAA, upscaling) blend
+    allocate(m_color, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, GL_LINEAR);
+    if (m_hasDepth)
+      allocate(m_depth, GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, GL_NEAREST);
+
+    GLenum target = m_samples ? GL_TEXTURE_2D_MULTISAMPLE : GL_TEXTURE_2D;
+    glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, target, m_color, 0);
+    if (m_hasDepth)
+      glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, target, m_depth, 0);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+      std::cerr << "ERROR::RENDER_TARGET::INCOMPLETE " << m_owner << ' ' << width << 'x' << height << std::endl;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  }
+
+  // draw into the target from here on
+  void bind() const {
+    glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+    glViewport(0, 0, m_width, m_height);
+  }
+
+  // copy the color into `into`, which has the same size; resolves samples
+  void resolve(const RenderTarget& into) const {
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_fbo);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, into.m_fbo);
+    glBlitFramebuffer(0, 0, m_width, m_height, 0, 0, into.m_width, into.m_height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  }
+
+  // copy the color into `fbo` (0 is the window), scaled to `width` x `height`
+  void blit(GLuint fbo, int width, int height) const {
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_fbo);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbo);
+    glBlitFramebuffer(0, 0, m_width, m_height, 0, 0, width, height, GL_COLOR_BUFFER_BIT,
+                      width == m_width && height == m_height ? GL_NEAREST : GL_LINEAR);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  }
+
+  // free the GL objects, must run while the context is still current
+  void release() {
+    GLRegistry::destroy(OBJ_FRAMEBUFFER, m_fbo);
+    GLRegistry::destroy(OBJ_TEXTURE, m_color);
+    GLRegistry::destroy(OBJ_TEXTURE, m_depth);
+    m_width = m_height = 0;
+  }
+
+  [[nodiscard]] GLuint fbo() const {
+    return m_fbo;
+  }
+
+  [[nodiscard]] GLuint color() const {
+    return m_color;
+  }
+
+  [[nodiscard]] int width() const {
+    return m_width;
+  }
+
+  [[nodiscard]] int height() const {
+    return m_height;
+  }
+
+  [[nodiscard]] int samples() const {
+    return m_samples;
+  }
+};
+
+// Reads frames back to the CPU without stalling. request() starts a copy
+// of the color into the next of kRing pixel buffers and fences it; poll()
+// maps only buffers whose fence has signalled, so frame N is read while
+// frames N+1 and N+2 render. When every buffer is still in flight the
+// request is dropped instead of waiting.
+class PixelReadback {
+ public:
+  static constexpr int kRing = 3;
+
+ protected:
+  struct s_slot {
+    GLuint pbo = 0;
+    std::size_t capacity = 0;
+    GLsync fence = nullptr;
+    int width = 0, height = 0;
+    std::uint64_t frame = 0;
+  };
+
+  std::array<s_slot, kRing> m_slots{};
+  int m_next = 0;    // slot the next request writes
+  int m_oldest = 0;  // slot poll() checks first
+  int m_pending = 0;
+  std::uint64_t m_dropped = 0;
+
+ public:
+  PixelReadback() = default;
+  PixelReadback(const PixelReadback&) = delete;
+  PixelReadback& operator=(const PixelReadback&) = delete;
+
+  ~PixelReadback() {
+    release();
+  }
+
+  // queue a copy of the color of `fbo` (0 reads the window's back buffer),
+  // tagged with `frame`; returns false when it had to be dropped
+  bool request(GLuint fbo, int width, int height, std::uint64_t frame) {
+    if (m_pending == kRing) {
+      m_dropped++;
+      return false;
+    }
+    PROFILE_ZONE("PixelReadback::request");
+    s_slot& slot = m_slots[m_next];
+    std::size_t bytes = (std::size_t)width * height * 4;
+    if (!slot.pbo)
+      slot.pbo = GLRegistry::create(OBJ_BUFFER, "PixelReadback");
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    if (bytes > slot.capacity) {
+      glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)bytes, nullptr, GL_STREAM_READ);
+      GLRegistry::setBytes(OBJ_BUFFER, slot.pbo, bytes);
+      slot.capacity = bytes;
+    }
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+    if (!fbo)
+      glReadBuffer(GL_BACK);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    // with a pack buffer bound the last argument is an offset, the call returns right away
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.width = width;
+    slot.height = height;
+    slot.frame = frame;
+    m_next = (m_next + 1) % kRing;
+    m_pending++;
+    return true;
+  }
+
+  bool request(const RenderTarget& target, std::uint64_t frame) {
+    return request(target.fbo(), target.width(), target.height(), frame);
+  }
+
+  // Hand every finished copy, oldest first, to
+  // `fn(const std::uint8_t* rgba, int width, int height, std::uint64_t frame)`.
+  // Rows are bottom to top; the pointer is only valid during the call.
+  // A nonzero `timeout_ns` waits that long for each copy instead of
+  // returning at the first unfinished one, e.g. to drain the ring at exit.
+  template <typename F>
+  int poll(F&& fn, GLuint64 timeout_ns = 0) {
+    int done = 0;
+    while (m_pending) {
+      s_slot& slot = m_slots[m_oldest];
+      GLenum state = glClientWaitSync(slot.fence, timeout_ns ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, timeout_ns);
+      if (state != GL_ALREADY_SIGNALED && state != GL_CONDITION_SATISFIED)
+        break;
+      PROFILE_ZONE("PixelReadback::map");
+      glDeleteSync(slot.fence);
+      slot.fence = nullptr;
+      std::size_t bytes = (std::size_t)slot.width * slot.height * 4;
+      glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+      auto* pixels = (const std::uint8_t*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)bytes,
+                                                           GL_MAP_READ_BIT);
+      if (pixels) {
+        fn(pixels, slot.width, slot.height, slot.frame);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        done++;
+      } else {
+        m_dropped++;
+      }
+      glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+      m_oldest = (m_oldest + 1) % kRing;
+      m_pending--;
+    }
+    return done;
+  }
+
+  // requests dropped because every buffer was in flight, the copy could
+  // not be mapped or release() came before it was polled
+  [[nodiscard]] std::uint64_t dropped() const {
+    return m_dropped;
+  }
+
+  // free the buffers and fences, must run while the context is still current
+  void release() {
+    m_dropped += (std::uint64_t)m_pending;
+    for (auto& slot : m_slots) {
+      if (slot.fence)
+        glDeleteSync(slot.fence);
+      slot.fence = nullptr;
+      GLRegistry::destroy(OBJ_BUFFER, slot.pbo);
+      slot.capacity = 0;
+    }
+    m_pending = 0;
+    m_next = m_oldest = 0;
+  }
+};
+}
+
+#endif // CUBE_SRC_ENGINE_RENDERTARGET_H_
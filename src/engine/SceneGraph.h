@@ -0,0 +1,203 @@
+#ifndef CUBE_SRC_ENGINE_SCENEGRAPH_H_
+#define CUBE_SRC_ENGINE_SCENEGRAPH_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+namespace engine {
+// Transform hierarchy. A node is an index into flat arrays holding its local
+// matrix, the world matrix derived from its parents and its links. setLocal()
+// and setParent() only mark a node dirty; update() then recomputes the world
+// matrices of the dirty subtrees and nothing else, and lists the nodes it
+// touched so the owner can react to exactly those.
+class SceneGraph {
+ public:
+  static constexpr std::uint32_t kNone = ~0u;
+  static constexpr std::uint32_t kRoot = 0; // the world, never destroyed
+
+ protected:
+  std::vector<glm::mat4> m_local, m_world;
+  std::vector<std::uint32_t> m_parent, m_firstChild, m_nextSibling, m_prevSibling;
+  std::vector<std::uint32_t> m_payload; // caller data, e.g. an entity index
+  std::vector<std::uint8_t> m_dirty;
+  std::vector<std::uint8_t> m_alive;
+
+  std::vector<std::uint32_t> m_free;       // destroyed nodes, reused first
+  std::vector<std::uint32_t> m_dirtyNodes; // marked since the last update
+  std::vector<std::uint32_t> m_updated;    // recomputed by the last update
+  std::vector<std::uint32_t> m_stack;
+
+  void markDirty(std::uint32_t id) {
+    if (m_dirty[id])
+      return;
+    m_dirty[id] = 1;
+    m_dirtyNodes.push_back(id);
+  }
+
+  void link(std::uint32_t id, std::uint32_t parent) {
+    m_parent[id] = parent;
+    m_prevSibling[id] = kNone;
+    m_nextSibling[id] = m_firstChild[parent];
+    if (m_firstChild[parent] != kNone)
+      m_prevSibling[m_firstChild[parent]] = id;
+    m_firstChild[parent] = id;
+  }
+
+  void unlink(std::uint32_t id) {
+    std::uint32_t parent = m_parent[id];
+    if (m_prevSibling[id] != kNone)
+      m_nextSibling[m_prevSibling[id]] = m_nextSibling[id];
+    else
+      m_firstChild[parent] = m_nextSibling[id];
+    if (m_nextSibling[id] != kNone)
+      m_prevSibling[m_nextSibling[id]] = m_prevSibling[id];
+    m_parent[id] = m_prevSibling[id] = m_nextSibling[id] = kNone;
+  }
+
+  // recompute `top` and everything below it
+  void refresh(std::uint32_t top) {
+    m_stack.push_back(top);
+    while (!m_stack.empty()) {
+      std::uint32_t id = m_stack.back();
+      m_stack.pop_back();
+      std::uint32_t parent = m_parent[id];
+      m_world[id] = parent == kNone ? m_local[id] : m_world[parent] * m_local[id];
+      m_dirty[id] = 0;
+      m_updated.push_back(id);
+      for (std::uint32_t child = m_firstChild[id]; child != kNone; child = m_nextSibling[child])
+        m_stack.push_back(child);
+    }
+  }
+
+ public:
+  SceneGraph() {
+    m_local.emplace_back(1.0f);
+    m_world.emplace_back(1.0f);
+    m_parent.push_back(kNone);
+    m_firstChild.push_back(kNone);
+    m_nextSibling.push_back(kNone);
+    m_prevSibling.push_back(kNone);
+    m_payload.push_back(kNone);
+    m_dirty.push_back(0);
+    m_alive.push_back(1);
+  }
+
+  std::uint32_t create(std::uint32_t parent = kRoot, const glm::mat4& local = glm::mat4(1.0f),
+                       std::uint32_t payload = kNone) {
+    std::uint32_t id;
+    if (!m_free.empty()) {
+      id = m_free.back();
+      m_free.pop_back();
+    } else {
+      id = (std::uint32_t)m_local.size();
+      m_local.emplace_back(1.0f);
+      m_world.emplace_back(1.0f);
+      m_parent.push_back(kNone);
+      m_firstChild.push_back(kNone);
+      m_nextSibling.push_back(kNone);
+      m_prevSibling.push_back(kNone);
+      m_payload.push_back(kNone);
+      m_dirty.push_back(0);
+      m_alive.push_back(0);
+    }
+    m_local[id] = local;
+    m_firstChild[id] = kNone;
+    m_payload[id] = payload;
+    m_alive[id] = 1;
+    link(id, parent);
+    markDirty(id);
+    return id;
+  }
+
+  // remove a node; its children move up to its parent with their local
+  // matrices unchanged
+  void destroy(std::uint32_t id) {
+    if (id == kRoot || id >= m_alive.size() || !m_alive[id])
+      return;
+    std::uint32_t parent = m_parent[id];
+    while (m_firstChild[id] != kNone) {
+      std::uint32_t child = m_firstChild[id];
+      unlink(child);
+      link(child, parent);
+      markDirty(child);
+    }
+    unlink(id);
+    m_alive[id] = 0;
+    m_dirty[id] = 0; // skipped if still listed in m_dirtyNodes
+    m_free.push_back(id);
+  }
+
+  void setLocal(std::uint32_t id, const glm::mat4& local) {
+    if (m_local[id] == local)
+      return;
+    m_local[id] = local;
+    markDirty(id);
+  }
+
+  // move a node under `parent`, keeping its local matrix
+  void setParent(std::uint32_t id, std::uint32_t parent) {
+    if (m_parent[id] == parent)
+      return;
+    unlink(id);
+    link(id, parent);
+    markDirty(id);
+  }
+
+  // Recompute the world matrices of every dirty subtree, each one from its
+  // topmost dirty node so no node is visited twice. Returns the number of
+  // nodes recomputed; updated() lists them.
+  std::size_t update() {
+    m_updated.clear();
+    for (std::size_t i = 0; i < m_dirtyNodes.size(); ++i) {
+      std::uint32_t id = m_dirtyNodes[i];
+      if (!m_dirty[id])
+        continue; // destroyed, or already refreshed with a dirty ancestor
+      std::uint32_t top = id;
+      for (std::uint32_t p = m_parent[id]; p != kNone; p = m_parent[p]) {
+        if (m_dirty[p])
+          top = p;
+      }
+      refresh(top);
+    }
+    m_dirtyNodes.clear();
+    return m_updated.size();
+  }
+
+  [[nodiscard]] const std::vector<std::uint32_t>& updated() const {
+    return m_updated;
+  }
+
+  [[nodiscard]] const glm::mat4& local(std::uint32_t id) const {
+    return m_local[id];
+  }
+
+  // as of the last update()
+  [[nodiscard]] const glm::mat4& world(std::uint32_t id) const {
+    return m_world[id];
+  }
+
+  [[nodiscard]] std::uint32_t parent(std::uint32_t id) const {
+    return m_parent[id];
+  }
+
+  [[nodiscard]] std::uint32_t firstChild(std::uint32_t id) const {
+    return m_firstChild[id];
+  }
+
+  [[nodiscard]] std::uint32_t nextSibling(std::uint32_t id) const {
+    return m_nextSibling[id];
+  }
+
+  [[nodiscard]] std::uint32_t payload(std::uint32_t id) const {
+    return m_payload[id];
+  }
+
+  [[nodiscard]] std::size_t size() const {
+    return m_local.size() - m_free.size();
+  }
+};
+}
+
+#endif // CUBE_SRC_ENGINE_SCENEGRAPH_H_
@@ -6,9 +6,22 @@
 #include <sstream>
 #include <iostream>
 #include <cstring>
+#include <source_location>
+#include <string_view>
 
 #include "glad/gl.h"
 
+// GL_KHR_parallel_shader_compile, missing from the generated loader
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+#include "glm/glm.hpp"
+
+#include "FrameStats.h"
+#include "GLRegistry.h"
+#include "Profiler.h"
+
 namespace engine {
 struct s_shader {
   std::string vShaderCode;
@@ -19,17 +32,39 @@ class Shader {
  protected:
   GLuint m_ID = 0;
   s_shader m_shader;
+  std::string m_name = "Shader"; // registry owner, the vertex shader path once loaded
+
+  // program being built by beginCompile(), swapped in by finishCompile()
+  GLuint m_pending = 0, m_pendingVertex = 0, m_pendingFragment = 0;
+
+  // program bound on this thread, lets use() skip redundant glUseProgram
+  static inline thread_local GLuint s_bound = 0;
+  static inline bool s_parallelCompile = false;
 
  public:
   Shader() = default;
 
-  Shader(const char* vertexPath, const char* fragmentPath) {
+  Shader(const char* vertexPath, const char* fragmentPath,
+         std::source_location site = std::source_location::current()) {
     load(vertexPath, fragmentPath);
-    compile();
+    compile(site);
   }
 
+  Shader(const Shader&) = delete;
+  Shader& operator=(const Shader&) = delete;
+
   ~Shader() {
-    glDeleteProgram(m_ID);
+    release();
+  }
+
+  // delete the program, must run while the context is still current
+  void release() {
+    discardCompile();
+    if (!m_ID)
+      return;
+    if (s_bound == m_ID)
+      s_bound = 0;
+    GLRegistry::destroy(OBJ_PROGRAM, m_ID);
   }
 
   void loadFromText(const std::string& vertexCode, const std::string& fragmentCode) {
@@ -38,6 +73,7 @@ class Shader {
   }
 
   void load(const char* vertexPath, const char* fragmentPath) {
+    m_name = vertexPath;
     std::ifstream vShaderFile, fShaderFile;
 
     vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
@@ -64,53 +100,145 @@ class Shader {
     }
   }
 
-  void compile() {
-    const char* vShaderCode = m_shader.vShaderCode.c_str();
-    const char* fShaderCode = m_shader.fShaderCode.c_str();
-    unsigned int vertex, fragment;
+  // `site` is recorded in the GL registry as the place the program was made
+  void compile(std::source_location site = std::source_location::current()) {
+    PROFILE_ZONE("Shader::compile");
+    beginCompile(m_shader.vShaderCode, m_shader.fShaderCode, site);
+    finishCompile();
+
+    m_shader.vShaderCode.clear();
+    m_shader.fShaderCode.clear();
+  }
+
+  // Turn on GL_KHR_parallel_shader_compile (or the ARB twin) when the driver
+  // has it: compiles and links then return at once and compileReady() polls
+  // them. Needs a current context; returns whether it is on.
+  static bool enableParallelCompile(GLADloadfunc load) {
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; ++i) {
+      const char* name = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, (GLuint)i));
+      bool khr = std::strcmp(name, "GL_KHR_parallel_shader_compile") == 0;
+      if (!khr && std::strcmp(name, "GL_ARB_parallel_shader_compile") != 0)
+        continue;
+      auto maxThreads = reinterpret_cast<void (*)(GLuint)>(
+          load(khr ? "glMaxShaderCompilerThreadsKHR" : "glMaxShaderCompilerThreadsARB"));
+      if (maxThreads)
+        maxThreads(0xFFFFFFFFu); // as many as the driver likes
+      s_parallelCompile = true;
+      return true;
+    }
+    return false;
+  }
+
+  // Start compiling and linking a new program from the given sources; the
+  // current one stays in use until finishCompile() swaps them.
+  void beginCompile(std::string_view vertexCode, std::string_view fragmentCode,
+                    std::source_location site = std::source_location::current()) {
+    PROFILE_ZONE("Shader::beginCompile");
+    discardCompile();
+    auto source = [](GLuint shader, std::string_view code) {
+      const char* text = code.data();
+      auto length = (GLint)code.size();
+      glShaderSource(shader, 1, &text, &length);
+      glCompileShader(shader);
+    };
+
+    m_pendingVertex = glCreateShader(GL_VERTEX_SHADER);
+    GLRegistry::track(OBJ_SHADER, m_pendingVertex, m_name.c_str(), site);
+    source(m_pendingVertex, vertexCode);
+
+    m_pendingFragment = glCreateShader(GL_FRAGMENT_SHADER);
+    GLRegistry::track(OBJ_SHADER, m_pendingFragment, m_name.c_str(), site);
+    source(m_pendingFragment, fragmentCode);
+
+    m_pending = glCreateProgram();
+    GLRegistry::track(OBJ_PROGRAM, m_pending, m_name.c_str(), site);
+    glAttachShader(m_pending, m_pendingVertex);
+    glAttachShader(m_pending, m_pendingFragment);
+    glLinkProgram(m_pending);
+  }
+
+  // false while the driver still works on the program from beginCompile()
+  [[nodiscard]] bool compileReady() const {
+    if (!m_pending || !s_parallelCompile)
+      return true;
+    GLint done = GL_FALSE;
+    glGetProgramiv(m_pending, GL_COMPLETION_STATUS_KHR, &done);
+    return done == GL_TRUE;
+  }
+
+  [[nodiscard]] bool compiling() const {
+    return m_pending != 0;
+  }
+
+  // Check the program from beginCompile() (blocking if it is not ready).
+  // On success it replaces the current program; on failure the errors are
+  // printed and the current program is kept.
+  bool finishCompile() {
+    if (!m_pending)
+      return false;
+    PROFILE_ZONE("Shader::finishCompile");
     int success;
     char infoLog[512];
+    bool ok = true;
 
-    vertex = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertex, 1, &vShaderCode, nullptr);
-    glCompileShader(vertex);
-    glGetShaderiv(vertex, GL_COMPILE_STATUS, &success);
-
+    glGetShaderiv(m_pendingVertex, GL_COMPILE_STATUS, &success);
     if(!success) {
-      glGetShaderInfoLog(vertex, 512, nullptr, infoLog);
-      std::cerr << "ERROR::SHADER::COMPILATION_FAILED\n" << infoLog << std::endl;
+      glGetShaderInfoLog(m_pendingVertex, 512, nullptr, infoLog);
+      std::cerr << "ERROR::SHADER::COMPILATION_FAILED " << m_name << " (vertex)\n" << infoLog << std::endl;
+      ok = false;
     }
 
-    fragment = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragment, 1, &fShaderCode, nullptr);
-    glCompileShader(fragment);
-    glGetShaderiv(fragment, GL_COMPILE_STATUS, &success);
-
+    glGetShaderiv(m_pendingFragment, GL_COMPILE_STATUS, &success);
     if(!success) {
-      glGetShaderInfoLog(fragment, 512, nullptr, infoLog);
-      std::cerr << "ERROR::SHADER::COMPILATION_FAILED\n" << infoLog << std::endl;
+      glGetShaderInfoLog(m_pendingFragment, 512, nullptr, infoLog);
+      std::cerr << "ERROR::SHADER::COMPILATION_FAILED " << m_name << " (fragment)\n" << infoLog << std::endl;
+      ok = false;
     }
 
-    m_ID = glCreateProgram();
-    glAttachShader(m_ID, vertex);
-    glAttachShader(m_ID, fragment);
-    glLinkProgram(m_ID);
+    glGetProgramiv(m_pending, GL_LINK_STATUS, &success);
+    if(ok && !success) {
+      glGetProgramInfoLog(m_pending, 512, nullptr, infoLog);
+      std::cerr << "ERROR::SHADER::CREATE_PROGRAM_FAILED " << m_name << "\n" << infoLog << std::endl;
+      ok = false;
+    }
 
-    glGetProgramiv(m_ID, GL_LINK_STATUS, &success);
-    if(!success) {
-      glGetShaderInfoLog(fragment, 512, nullptr, infoLog);
-      std::cerr << "ERROR::SHADER::CREATE_PROGRAM_FAILED\n" << infoLog << glGetError() << std::endl;
+    GLRegistry::destroy(OBJ_SHADER, m_pendingVertex);
+    GLRegistry::destroy(OBJ_SHADER, m_pendingFragment);
+    if (!ok) {
+      GLRegistry::destroy(OBJ_PROGRAM, m_pending);
+      return false;
     }
+    GLuint program = m_pending;
+    m_pending = 0;
+    release();
+    m_ID = program;
+    return true;
+  }
 
-    glDeleteShader(vertex);
-    glDeleteShader(fragment);
+  // drop a compile started with beginCompile()
+  void discardCompile() {
+    GLRegistry::destroy(OBJ_SHADER, m_pendingVertex);
+    GLRegistry::destroy(OBJ_SHADER, m_pendingFragment);
+    GLRegistry::destroy(OBJ_PROGRAM, m_pending);
+  }
 
-    m_shader.vShaderCode.clear();
-    m_shader.fShaderCode.clear();
+  void setName(std::string name) {
+    m_name = std::move(name);
+  }
+
+  [[nodiscard]] const std::string& name() const {
+    return m_name;
   }
 
   void use() const {
+    if (s_bound == m_ID) {
+      FrameStats::current().gl_calls_elided++;
+      return;
+    }
     glUseProgram(m_ID);
+    s_bound = m_ID;
   }
 
   [[nodiscard]] GLuint get() const {
@@ -145,6 +273,10 @@ class Shader {
     glUniform3f(glGetUniformLocation(m_ID, name.c_str()), x, y, z);
   }
 
+  void setVec3(const std::string &name, const glm::vec3 *values, GLsizei count) const {
+    glUniform3fv(glGetUniformLocation(m_ID, name.c_str()), count, &values[0][0]);
+  }
+
   void setVec4(const std::string &name, const glm::vec4 &value) const {
     glUniform4fv(glGetUniformLocation(m_ID, name.c_str()), 1, &value[0]);
   }
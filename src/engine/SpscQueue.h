@@ -0,0 +1,63 @@
+#ifndef CUBE_SRC_ENGINE_SPSCQUEUE_H_
+#define CUBE_SRC_ENGINE_SPSCQUEUE_H_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace engine {
+// Bounded single-producer/single-consumer ring.
+// One thread pushes, one thread pops, neither side locks or waits.
+template <typename T, std::size_t Capacity>
+class SpscQueue {
+ protected:
+  std::array<T, Capacity> m_items{};
+  alignas(64) std::atomic<std::size_t> m_head{0}; // next slot to read
+  alignas(64) std::atomic<std::size_t> m_tail{0}; // next slot to write
+  std::atomic<std::uint64_t> m_dropped{0};
+
+ public:
+  SpscQueue() = default;
+  SpscQueue(const SpscQueue&) = delete;
+  SpscQueue& operator=(const SpscQueue&) = delete;
+
+  bool push(const T& item) {
+    std::size_t tail = m_tail.load(std::memory_order_relaxed);
+    if (tail - m_head.load(std::memory_order_acquire) >= Capacity) {
+      m_dropped.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    m_items[tail % Capacity] = item;
+    m_tail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool pop(T& item) {
+    std::size_t head = m_head.load(std::memory_order_relaxed);
+    if (head == m_tail.load(std::memory_order_acquire))
+      return false;
+    item = m_items[head % Capacity];
+    m_head.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // oldest item without removing it, consumer side only
+  [[nodiscard]] const T* peek() const {
+    std::size_t head = m_head.load(std::memory_order_relaxed);
+    if (head == m_tail.load(std::memory_order_acquire))
+      return nullptr;
+    return &m_items[head % Capacity];
+  }
+
+  [[nodiscard]] std::size_t size() const {
+    return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire);
+  }
+
+  [[nodiscard]] std::uint64_t dropped() const {
+    return m_dropped.load(std::memory_order_relaxed);
+  }
+};
+}
+
+#endif // CUBE_SRC_ENGINE_SPSCQUEUE_H_
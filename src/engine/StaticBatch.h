@@ -0,0 +1,127 @@
+#ifndef CUBE_SRC_ENGINE_STATICBATCH_H_
+#define CUBE_SRC_ENGINE_STATICBATCH_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "glad/gl.h"
+
+#include "glm/glm.hpp"
+
+#include "FrameStats.h"
+#include "GLRegistry.h"
+#include "Profiler.h"
+#include "primitives/RubikAtomCube.h"
+
+namespace engine {
+// Many boxes that do not move, merged into one vertex buffer and drawn with
+// a single call. The merge runs on any thread and only fills a CPU copy;
+// the buffer is uploaded by the next draw() on the GL thread. `key` tells
+// which state the batch was built for, so the owner knows when to rebuild.
+class StaticBatch {
+ protected:
+  struct s_vertex {
+    glm::vec3 position;
+    glm::vec3 color; // same attribute locations as RubikAtomCube
+    glm::vec2 uv;
+  };
+
+  std::vector<s_vertex> m_vertices; // kept for the next build's capacity
+  GLuint m_vao = 0, m_vbo = 0;
+  GLsizei m_uploaded = 0; // vertices in the buffer
+  bool m_dirty = false;
+  std::uint64_t m_key = ~0ull;
+
+  void upload() {
+    PROFILE_ZONE("StaticBatch::upload");
+    if (!m_vao) {
+      m_vao = GLRegistry::create(OBJ_VERTEX_ARRAY, "StaticBatch");
+      m_vbo = GLRegistry::create(OBJ_BUFFER, "StaticBatch");
+      glBindVertexArray(m_vao);
+      glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+      glEnableVertexAttribArray(0);
+      glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(s_vertex), (void*)offsetof(s_vertex, position));
+      glEnableVertexAttribArray(1);
+      glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(s_vertex), (void*)offsetof(s_vertex, color));
+      glEnableVertexAttribArray(2);
+      glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(s_vertex), (void*)offsetof(s_vertex, uv));
+      glBindVertexArray(0);
+    }
+    std::size_t bytes = m_vertices.size() * sizeof(s_vertex);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)bytes, m_vertices.data(), GL_STATIC_DRAW);
+    GLRegistry::setBytes(OBJ_BUFFER, m_vbo, bytes);
+    FrameStats::current().bytes_uploaded += bytes;
+    m_uploaded = (GLsizei)m_vertices.size();
+    m_dirty = false;
+  }
+
+ public:
+  StaticBatch() = default;
+  StaticBatch(const StaticBatch&) = delete;
+  StaticBatch& operator=(const StaticBatch&) = delete;
+
+  ~StaticBatch() {
+    release();
+  }
+
+  // drop the merged boxes and start a build for state `key`
+  void begin(std::uint64_t key) {
+    m_vertices.clear();
+    m_key = key;
+    m_dirty = true;
+  }
+
+  // merge the faces `mesh` draws, placed by `transform`
+  void add(const primitives::RubikAtomCube& mesh, const glm::mat4& transform) {
+    std::uint8_t faces = mesh.getFaces();
+    for (int face = 0; face < 6; ++face) {
+      if (!(faces & (1 << face)))
+        continue;
+      auto corners = mesh.faceCorners(face);
+      for (auto& corner : corners)
+        corner = glm::vec3(transform * glm::vec4(corner, 1.0f));
+      glm::vec3 color = mesh.faceColor(face);
+      for (int corner : {0, 1, 2, 2, 3, 0})
+        m_vertices.push_back({corners[corner], color, primitives::RubikAtomCube::kFaceUvs[corner]});
+    }
+  }
+
+  // draw with the program, view and model already set
+  void draw() {
+    PROFILE_ZONE("StaticBatch::draw");
+    if (m_dirty)
+      upload();
+    if (!m_uploaded)
+      return;
+    glBindVertexArray(m_vao);
+    glDrawArrays(GL_TRIANGLES, 0, m_uploaded);
+    glBindVertexArray(0);
+    FrameStats::current().draw_calls++;
+  }
+
+  // free the buffers, must run while the context is still current
+  void release() {
+    GLRegistry::destroy(OBJ_VERTEX_ARRAY, m_vao);
+    GLRegistry::destroy(OBJ_BUFFER, m_vbo);
+    m_uploaded = 0;
+    m_dirty = !m_vertices.empty();
+  }
+
+  [[nodiscard]] std::uint64_t key() const {
+    return m_key;
+  }
+
+  [[nodiscard]] bool empty() const {
+    return m_vertices.empty();
+  }
+
+  // triangles merged by the last build
+  [[nodiscard]] std::size_t triangles() const {
+    return m_vertices.size() / 3;
+  }
+};
+}
+
+#endif // CUBE_SRC_ENGINE_STATICBATCH_H_
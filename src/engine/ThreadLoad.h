@@ -0,0 +1,53 @@
+#ifndef CUBE_SRC_ENGINE_THREADLOAD_H_
+#define CUBE_SRC_ENGINE_THREADLOAD_H_
+
+#include <atomic>
+#include <cstdint>
+
+#include "Input.h"
+
+namespace engine {
+// Busy vs. wall-clock time of one loop thread. The owning thread brackets
+// its work with begin()/end(), any thread may read the counters.
+class ThreadLoad {
+ protected:
+  std::atomic<std::int64_t> m_busyNs{0};
+  std::atomic<std::int64_t> m_startNs{0};
+  std::atomic<std::uint64_t> m_iterations{0};
+  std::int64_t m_begin = 0;
+
+ public:
+  // (re)start measuring, clears the counters of a previous run
+  void start() {
+    m_busyNs.store(0, std::memory_order_relaxed);
+    m_iterations.store(0, std::memory_order_relaxed);
+    m_startNs.store(now_ns(), std::memory_order_relaxed);
+  }
+
+  void begin() {
+    m_begin = now_ns();
+  }
+
+  void end() {
+    m_busyNs.fetch_add(now_ns() - m_begin, std::memory_order_relaxed);
+    m_iterations.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // fraction of time spent working since start()
+  [[nodiscard]] double utilization() const {
+    std::int64_t wall = now_ns() - m_startNs.load(std::memory_order_relaxed);
+    return wall > 0 ? (double)m_busyNs.load(std::memory_order_relaxed) / (double)wall : 0.0;
+  }
+
+  [[nodiscard]] std::uint64_t iterations() const {
+    return m_iterations.load(std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] double busyMsPerIteration() const {
+    std::uint64_t n = iterations();
+    return n ? (double)m_busyNs.load(std::memory_order_relaxed) / (double)n / 1e6 : 0.0;
+  }
+};
+}
+
+#endif // CUBE_SRC_ENGINE_THREADLOAD_H_
@@ -0,0 +1,54 @@
+#ifndef CUBE_SRC_ENGINE_TRIPLEBUFFER_H_
+#define CUBE_SRC_ENGINE_TRIPLEBUFFER_H_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace engine {
+// Lock-free triple buffer for one writer and one reader.
+// The writer fills back(), publish() swaps it with the shared middle slot;
+// the reader's acquire() swaps the middle slot into front() when it holds
+// something newer. Both sides only exchange an index, so neither ever waits.
+template <typename T>
+class TripleBuffer {
+ protected:
+  static constexpr std::uint8_t kIndexMask = 0x3;
+  static constexpr std::uint8_t kFreshBit = 0x4;
+
+  std::array<T, 3> m_slots{};
+  alignas(64) std::atomic<std::uint8_t> m_middle{1}; // index | kFreshBit
+  alignas(64) std::uint8_t m_back = 0;   // writer only
+  alignas(64) std::uint8_t m_front = 2;  // reader only
+
+ public:
+  TripleBuffer() = default;
+  TripleBuffer(const TripleBuffer&) = delete;
+  TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+  // writer side
+  T& back() {
+    return m_slots[m_back];
+  }
+
+  void publish() {
+    std::uint8_t old = m_middle.exchange(m_back | kFreshBit, std::memory_order_acq_rel);
+    m_back = old & kIndexMask;
+  }
+
+  // reader side, returns true when front() changed
+  bool acquire() {
+    if (!(m_middle.load(std::memory_order_relaxed) & kFreshBit))
+      return false;
+    std::uint8_t old = m_middle.exchange(m_front, std::memory_order_acq_rel);
+    m_front = old & kIndexMask;
+    return true;
+  }
+
+  const T& front() const {
+    return m_slots[m_front];
+  }
+};
+}
+
+#endif // CUBE_SRC_ENGINE_TRIPLEBUFFER_H_
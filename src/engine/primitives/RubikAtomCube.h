@@ -5,6 +5,10 @@
 #ifndef CUBE_SRC_ENGINE_PRIMITIVES_RUBIKATOMCUBE_H_
 #define CUBE_SRC_ENGINE_PRIMITIVES_RUBIKATOMCUBE_H_
 
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <source_location>
 #include <vector>
 
 #include "glad/gl.h"
@@ -17,6 +21,16 @@
 #include "../Shader.h"
 
 namespace engine::primitives {
+  // face order of RubikAtomCube, also the bit of each face in a face mask
+  enum CubeFace : std::uint8_t {
+    FACE_POS_Z = 0,
+    FACE_POS_X = 1,
+    FACE_NEG_Z = 2,
+    FACE_NEG_X = 3,
+    FACE_POS_Y = 4,
+    FACE_NEG_Y = 5,
+  };
+
   class RubikAtomCube {
   protected:
     std::vector<GLint> m_indices;
@@ -24,10 +38,11 @@ namespace engine::primitives {
     std::vector<glm::vec3> m_vertices;
     std::vector<glm::vec3> m_colors;
 
-    std::vector<GLuint> m_vao{0}, m_vbo{0}, m_ebo{0}, m_nbo{0}, m_cbo{0};
+    // the faces that are drawn, a mask of CubeFace bits
+    std::uint8_t m_faces = 0x3F;
 
     Camera m_camera;
-    Shader* m_shader = nullptr;
+    std::shared_ptr<Shader> m_shader; // usually one program shared by every cube
 
     glm::vec3 m_dimensions{1.0f, 1.0f, 1.0f};
     glm::vec3 m_position{0.0f, 0.0f, 0.0f};
@@ -74,165 +89,58 @@ namespace engine::primitives {
       };
     };
 
-    std::vector<GLint> m_in{0, 1, 2, 2, 3, 0};
-
-    void setupMesh() {
-      for (int i = 0; i < 6; ++i) {
-        std::vector<glm::vec3> v;
-
-        v.push_back(m_vertices[m_indices[i * 6 + 0]]);
-        v.push_back(m_vertices[m_indices[i * 6 + 1]]);
-        v.push_back(m_vertices[m_indices[i * 6 + 2]]);
-        v.push_back(m_vertices[m_indices[i * 6 + 4]]);
-
-        glGenVertexArrays(1, &m_vao[i]);
-        glBindVertexArray(m_vao[i]);
-
-        // vertices
-        glGenBuffers(1, &m_vbo[i]);
-        glBindBuffer(GL_ARRAY_BUFFER, m_vbo[i]);
-        glBufferData(GL_ARRAY_BUFFER, 4 * sizeof(glm::vec3),
-                     v.data(), GL_STATIC_DRAW);
-
-        // triangles indices (vertex order)
-        glGenBuffers(1, &m_ebo[i]);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo[i]);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, 6 * sizeof(GLuint),
-                     m_in.data(), GL_STATIC_DRAW);
-
-
-        // vertex positions
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float),
-                              nullptr);
-
-        /*// colors
-        std::vector<glm::vec3> c = {
-            {0.33f, 0.2f, 0.1f},
-            {0.33f, 0.2f, 0.1f},
-            {0.33f, 0.2f, 0.1f},
-            {0.33f, 0.2f, 0.1f},
-            {0.33f, 0.2f, 0.1f},
-            {0.33f, 0.2f, 0.1f},
-        };
-        glGenBuffers(1, &m_cbo[i]);
-        glEnableVertexAttribArray(1);
-        glBufferData(GL_ARRAY_BUFFER, 6 * sizeof(glm::vec3), &c,
-                     GL_STATIC_DRAW);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float),
-                              nullptr);*/
-
-        glGenBuffers(1, &m_cbo[i]);
-        glBindBuffer(GL_ARRAY_BUFFER, m_cbo[i]);
-
-        if (!m_colors.empty()) {
-          std::vector<glm::vec3> color = {
-              m_colors[i],
-              m_colors[i],
-              m_colors[i],
-              m_colors[i],
-              m_colors[i],
-              m_colors[i],
-          };
-          glBufferData(GL_ARRAY_BUFFER, color.size() * sizeof(glm::vec3), color.data(),
-                       GL_STATIC_DRAW);
-        }
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float),
-                              nullptr);
-        glEnableVertexAttribArray(1);
-      }
-    }
-
-    void update() {
-      for (int i = 0; i < 6; ++i) {
-        std::vector<glm::vec3> color = {
-          m_colors[i],
-          m_colors[i],
-          m_colors[i],
-          m_colors[i],
-          m_colors[i],
-          m_colors[i],
-        };
-
-        glBindVertexArray(m_vao[i]);
-        glBindBuffer(GL_ARRAY_BUFFER, m_cbo[i]);
-        glBufferData(GL_ARRAY_BUFFER, color.size() * sizeof(glm::vec3), color.data(),
-                     GL_STATIC_DRAW);
-      }
-      /*std::vector<glm::vec3> c = {
-          {0.33f, 0.2f, 0.1f},
-          {0.33f, 0.2f, 0.1f},
-          {0.33f, 0.2f, 0.1f},
-          {0.33f, 0.2f, 0.1f},
-          {0.33f, 0.2f, 0.1f},
-          {0.33f, 0.2f, 0.1f},
-      };
-      glBindVertexArray(m_vao[0]);
-      glGenBuffers(1, &m_cbo[0]);
-      glEnableVertexAttribArray(1);
-      glBindBuffer(GL_ARRAY_BUFFER, m_cbo[0]);
-      glBufferData(GL_ARRAY_BUFFER, 6 * sizeof(glm::vec3), &c,
-                   GL_STATIC_DRAW);*/
-    }
   public:
     explicit RubikAtomCube(const glm::vec3& center, const glm::vec3& dimensions)
         : m_dimensions(dimensions), m_position(center) {
-      m_vao.reserve(6);
-      m_vbo.reserve(6);
-      m_ebo.reserve(6);
-      m_nbo.reserve(6);
-      m_cbo.reserve(6);
       triangulate(m_position, m_dimensions);
-      setupMesh();
     }
-    ~RubikAtomCube() {
-      for (int i = 0; i < 6; ++i) {
-        glDeleteVertexArrays(1, &m_vao[i]);
-        glDeleteBuffers(1, &m_vbo[i]);
-        glDeleteBuffers(1, &m_ebo[i]);
-        glDeleteBuffers(1, &m_nbo[i]);
-        glDeleteBuffers(1, &m_cbo[i]);
-      }
-    }
-
     void addColor(glm::vec3 color) {
       m_colors.push_back(color);
-      update();
     }
 
     void setColors(std::vector<glm::vec3> colors) {
       m_colors = std::move(colors);
-      update();
     }
 
     std::vector<glm::vec3>* getColors() {
       return &m_colors;
     }
 
-    inline virtual void draw() {
-      glBindVertexArray(m_vao[0]);
-      glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr);
-      glBindVertexArray(0);
-
-      glBindVertexArray(m_vao[1]);
-      glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr);
-      glBindVertexArray(0);
+    // choose the faces that are drawn, a mask of CubeFace bits
+    void setFaces(std::uint8_t faces) {
+      m_faces = faces & 0x3F;
+    }
 
-      glBindVertexArray(m_vao[2]);
-      glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr);
-      glBindVertexArray(0);
+    [[nodiscard]] std::uint8_t getFaces() const {
+      return m_faces;
+    }
 
-      glBindVertexArray(m_vao[3]);
-      glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr);
-      glBindVertexArray(0);
+    // texture coordinates of the corners faceCorners() returns, the
+    // fragment shader draws the sticker from them
+    static constexpr std::array<glm::vec2, 4> kFaceUvs = {{{0.0f, 0.0f}, {1.0f, 0.0f}, {1.0f, 1.0f}, {0.0f, 1.0f}}};
+
+    // the corners of `face`, drawn as the triangles 0 1 2 and 2 3 0
+    [[nodiscard]] std::array<glm::vec3, 4> faceCorners(int face) const {
+      return {
+          m_vertices[m_indices[face * 6 + 0]],
+          m_vertices[m_indices[face * 6 + 1]],
+          m_vertices[m_indices[face * 6 + 2]],
+          m_vertices[m_indices[face * 6 + 4]],
+      };
+    }
 
-      glBindVertexArray(m_vao[4]);
-      glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr);
-      glBindVertexArray(0);
+    [[nodiscard]] glm::vec3 faceColor(int face) const {
+      return face < (int)m_colors.size() ? m_colors[face] : glm::vec3(0.0f);
+    }
 
-      glBindVertexArray(m_vao[5]);
-      glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr);
-      glBindVertexArray(0);
+    // the face pointing along `direction`, an axis of the cube's space
+    static CubeFace faceAlong(const glm::vec3& direction) {
+      glm::vec3 a = glm::abs(direction);
+      if (a.x >= a.y && a.x >= a.z)
+        return direction.x > 0.0f ? FACE_POS_X : FACE_NEG_X;
+      if (a.y >= a.z)
+        return direction.y > 0.0f ? FACE_POS_Y : FACE_NEG_Y;
+      return direction.z > 0.0f ? FACE_POS_Z : FACE_NEG_Z;
     }
 
     void setCamera(const Camera& camera) {
@@ -247,6 +155,14 @@ namespace engine::primitives {
       m_camera.rotate(axis, angle);
     }
 
+    [[nodiscard]] const Camera& getCamera() const {
+      return m_camera;
+    }
+
+    void setModel(const glm::mat4& model) {
+      m_camera.setModel(model);
+    }
+
     void rotateXYZ(glm::vec3 axis, float angle) {
       glm::vec3 center(0.0f);
       for (auto v : m_vertices)
@@ -265,7 +181,20 @@ namespace engine::primitives {
         vertex = rotationMatrix * vertex;
         v = glm::vec3(vertex.x, vertex.y, vertex.z);
       }
-      setupMesh();
+    }
+
+    [[nodiscard]] const std::vector<glm::vec3>& getVertices() const {
+      return m_vertices;
+    }
+
+    // replace the 8 corners, e.g. with the ones published by the simulation
+    void setVertices(const glm::vec3* corners) {
+      glm::vec3 center(0.0f);
+      for (std::size_t i = 0; i < m_vertices.size(); ++i) {
+        m_vertices[i] = corners[i];
+        center += corners[i];
+      }
+      m_position = center / (float)m_vertices.size();
     }
 
     void setPerspective(float fov, float aspect, float near, float far) {
@@ -276,8 +205,17 @@ namespace engine::primitives {
       m_camera.apply(shader);
     }
 
-    void createShader(const char* vertexShader, const char* fragmentShader) {
-      m_shader = new Shader(vertexShader, fragmentShader);
+    void createShader(const char* vertexShader, const char* fragmentShader,
+                      std::source_location site = std::source_location::current()) {
+      m_shader = std::make_shared<Shader>(vertexShader, fragmentShader, site);
+    }
+
+    void setShader(std::shared_ptr<Shader> shader) {
+      m_shader = std::move(shader);
+    }
+
+    [[nodiscard]] const std::shared_ptr<Shader>& getShader() const {
+      return m_shader;
     }
 
     inline void useShader() {
@@ -292,25 +230,21 @@ namespace engine::primitives {
     void move(const glm::vec3& offset) {
       m_position += offset;
       triangulate(m_position, m_dimensions);
-      setupMesh();
     }
 
     void scale(const glm::vec3& scale) {
       m_dimensions *= scale;
       triangulate(m_position, m_dimensions);
-      setupMesh();
     }
 
     void setDimensions(const glm::vec3& dimensions) {
       m_dimensions = dimensions;
       triangulate(m_position, m_dimensions);
-      setupMesh();
     }
 
     void setPosition(const glm::vec3& position) {
       m_position = position;
       triangulate(m_position, m_dimensions);
-      setupMesh();
     }
 
     [[nodiscard]] glm::vec3 getDimensions() const {
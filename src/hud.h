@@ -0,0 +1,127 @@
+#ifndef CUBE_SRC_HUD_H_
+#define CUBE_SRC_HUD_H_
+
+#include <cstdio>
+#include <cstdint>
+#include <string>
+
+#include "glm/glm.hpp"
+
+#include "engine/FrameStats.h"
+#include "engine/GLRegistry.h"
+#include "engine/GLTrace.h"
+#include "engine/Input.h"
+#include "engine/Memory.h"
+#include "engine/Overlay.h"
+
+// values shown by the performance overlay that the engine does not track itself
+struct s_hud_stats {
+  std::size_t queued_moves = 0;
+  double sim_load = 0.0;    // 0-1
+  double render_load = 0.0; // 0-1
+  const char* aa = "off";   // anti-aliasing mode
+  float render_scale = 1.0f; // of the scene's target, see DynamicResolution
+};
+
+struct s_hud {
+  engine::FrameTimeHistory frames;
+  std::int64_t last_update = 0;
+  float budget_ms = 1000.0f / 144.0f;
+};
+
+// Record the frame that just finished and, a few times per second, rebuild
+// the overlay batch. Between rebuilds the overlay is redrawn unchanged.
+void update_hud(s_hud *hud, engine::Overlay *overlay, float frame_ms, const s_hud_stats& stats) {
+  hud->frames.add(frame_ms);
+  std::int64_t now = engine::now_ns();
+  if (!overlay->visible() || now - hud->last_update < 250'000'000)
+    return;
+  hud->last_update = now;
+
+  const engine::s_frame_counters& counters = engine::FrameStats::last();
+  const glm::vec4 white{1.0f, 1.0f, 1.0f, 1.0f};
+  const glm::vec4 grey{0.7f, 0.7f, 0.7f, 1.0f};
+  char line[96];
+
+  overlay->clear();
+  const float x = 8.0f, lh = overlay->lineHeight();
+  const bool glTrace = engine::GLTrace::installed();
+  const int lines = glTrace ? 14 : 11;
+  const float graphH = 40.0f;
+  const float panelW = overlay->charWidth() * 30.0f + 16.0f;
+  overlay->rect(0.0f, 0.0f, panelW, lh * lines + graphH + 24.0f, {0.0f, 0.0f, 0.0f, 0.6f});
+
+  float y = 8.0f;
+  float mean = hud->frames.mean();
+  std::snprintf(line, sizeof(line), "FPS %6.1f  FRAME %5.2f MS", mean > 0.0f ? 1000.0f / mean : 0.0f, mean);
+  overlay->text(x, y, line, white);
+  y += lh;
+  std::snprintf(line, sizeof(line), "P50 %5.2f P95 %5.2f P99 %5.2f",
+                hud->frames.percentile(50.0f), hud->frames.percentile(95.0f),
+                hud->frames.percentile(99.0f));
+  overlay->text(x, y, line, white);
+  y += lh;
+  std::snprintf(line, sizeof(line), "DRAW CALLS     %8llu", (unsigned long long)counters.draw_calls);
+  overlay->text(x, y, line, grey);
+  y += lh;
+  std::snprintf(line, sizeof(line), "GL CALLS ELIDED %7llu", (unsigned long long)counters.gl_calls_elided);
+  overlay->text(x, y, line, grey);
+  y += lh;
+  std::snprintf(line, sizeof(line), "UPLOADED  %10.1f KB", (double)counters.bytes_uploaded / 1024.0);
+  overlay->text(x, y, line, grey);
+  y += lh;
+  std::snprintf(line, sizeof(line), "GPU MEM %6.1f KB  OBJ %4zu", (double)engine::GLRegistry::bytes() / 1024.0,
+                engine::GLRegistry::liveTotal());
+  overlay->text(x, y, line, grey);
+  y += lh;
+  std::snprintf(line, sizeof(line), "HEAP %4llu/F ARENA %5.1f KB", (unsigned long long)counters.heap_allocations,
+                (double)engine::FrameArena::thread().peak() / 1024.0);
+  overlay->text(x, y, line, grey);
+  y += lh;
+  std::snprintf(line, sizeof(line), "QUEUED MOVES   %8zu", stats.queued_moves);
+  overlay->text(x, y, line, grey);
+  y += lh;
+  std::snprintf(line, sizeof(line), "SIM %3.0f%%  RENDER %3.0f%%", stats.sim_load * 100.0, stats.render_load * 100.0);
+  overlay->text(x, y, line, grey);
+  y += lh;
+  std::snprintf(line, sizeof(line), "AA %19s", stats.aa);
+  overlay->text(x, y, line, grey);
+  y += lh;
+  std::snprintf(line, sizeof(line), "RENDER SCALE   %7.0f%%", stats.render_scale * 100.0);
+  overlay->text(x, y, line, grey);
+  y += lh;
+  if (glTrace) {
+    const engine::s_gl_counters& gl = engine::GLTrace::last();
+    std::uint64_t created = 0, deleted = 0;
+    for (int t = 0; t < engine::OBJ_COUNT; ++t) {
+      created += gl.created[t];
+      deleted += gl.deleted[t];
+    }
+    std::snprintf(line, sizeof(line), "GL CALLS       %8llu", (unsigned long long)gl.totalCalls());
+    overlay->text(x, y, line, grey);
+    y += lh;
+    std::snprintf(line, sizeof(line), "GL BUFFERS %10.1f KB", (double)gl.buffer_bytes / 1024.0);
+    overlay->text(x, y, line, grey);
+    y += lh;
+    std::snprintf(line, sizeof(line), "GL OBJ +%llu -%llu LIVE %lld", (unsigned long long)created,
+                  (unsigned long long)deleted, (long long)engine::GLTrace::liveTotal());
+    overlay->text(x, y, line, grey);
+    y += lh;
+  }
+  y += 8.0f;
+
+  // frame time graph, newest on the right, full height is two frame budgets
+  const int bars = 120;
+  const float barW = (panelW - 16.0f) / (float)bars;
+  for (int i = 0; i < bars; ++i) {
+    float ms = hud->frames.recent((std::size_t)(bars - 1 - i));
+    float h = glm::clamp(ms / (hud->budget_ms * 2.0f), 0.0f, 1.0f) * graphH;
+    glm::vec4 color = ms <= hud->budget_ms ? glm::vec4{0.2f, 0.8f, 0.3f, 1.0f}
+                      : ms <= hud->budget_ms * 1.5f ? glm::vec4{0.9f, 0.8f, 0.2f, 1.0f}
+                                                    : glm::vec4{0.9f, 0.2f, 0.2f, 1.0f};
+    overlay->rect(x + (float)i * barW, y + graphH - h, barW, h, color);
+  }
+  overlay->rect(x, y + graphH * 0.5f, panelW - 16.0f, 1.0f, {1.0f, 1.0f, 1.0f, 0.4f});
+}
+
+#endif // CUBE_SRC_HUD_H_
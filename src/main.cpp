@@ -1,4 +1,6 @@
+#include <algorithm>
 #include <chrono>
+#include <cstdint>
 #include <iostream>
 #include <thread>
 
@@ -6,14 +8,45 @@
 #include "glfw/glfw3.h"
 
 #include "glm/glm.hpp"
+#include "glm/gtc/matrix_transform.hpp"
 
+#include "engine/Assets.h"
+#include "engine/DynamicResolution.h"
+#include "engine/FrameStats.h"
+#include "engine/GLRegistry.h"
+#include "engine/GLTrace.h"
+#include "engine/Jobs.h"
+#include "engine/Latency.h"
+#include "engine/Memory.h"
+#include "engine/Metrics.h"
+#include "engine/Overlay.h"
+#include "engine/PostProcess.h"
+#include "engine/Recorder.h"
+#include "engine/RenderQueue.h"
+
+#include "allocations.h"
 #include "callbacks.h"
+#include "capture.h"
+#include "hud.h"
+#include "options.h"
+#include "simulation.h"
+#include "stress.h"
+
+int main(int argc, char** argv) {
+  s_options options;
+  OptionsResult parsed = parse_options(argc, argv, &options);
+  if (parsed != OPTIONS_RUN)
+    return parsed == OPTIONS_HELP ? 0 : 2;
 
-int main() {
   glfwInit();
   glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
   glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
   glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+  if (options.headless)
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+  // a window hint, so it has to be given before the window is created; with
+  // --dynamic-res the scene is drawn offscreen and the target has the samples
+  glfwWindowHint(GLFW_SAMPLES, options.dynamic_res ? 0 : aa_samples(options.aa));
 
   GLFWwindow* window = glfwCreateWindow(1080, 720, "rubik", nullptr, nullptr);
   if (!window) {
@@ -24,9 +57,11 @@ int main() {
   glfwMakeContextCurrent(window);
   glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
   glfwSetScrollCallback(window, scroll_callback);
-  glfwWindowHint(GLFW_SAMPLES, 4);
+  glfwSetKeyCallback(window, key_callback);
 
-  if (!gladLoadGL(glfwGetProcAddress))
+  int loaded = options.gl_trace ? engine::GLTrace::install(glfwGetProcAddress)
+                                : gladLoadGL(glfwGetProcAddress);
+  if (!loaded)
   {
     std::cerr << "GLAD::ERROR: Failed to initialize GLAD" << std::endl;
     return -1;
@@ -34,9 +69,26 @@ int main() {
 
   glEnable(GL_DEPTH_TEST);
   glDepthFunc(GL_LESS);
-  glEnable(GL_MULTISAMPLE);
+  if (aa_samples(options.aa))
+    glEnable(GL_MULTISAMPLE);
+  else
+    glDisable(GL_MULTISAMPLE);
+
+  // shaders are read by the job threads and compiled in the background where
+  // the driver can; the first frames draw with placeholders
+  engine::JobSystem jobs(options.threads);
+  engine::Shader::enableParallelCompile(glfwGetProcAddress);
+  engine::AssetLoader assets(jobs);
+  if (options.hot_reload)
+    assets.enableHotReload(); // edits to src/shaders show up without a restart
 
-  struct s_rubik rubik = make_rubik();
+  // the simulation owns its own GL-free copy of the puzzle and runs on a
+  // separate thread; the render copy is updated from published snapshots
+  engine::EntityStore scene;
+  struct s_rubik rubik = make_rubik(&scene, true, assets.loadShader("../src/shaders/rubikVertex.glsl",
+                                                                    "../src/shaders/rubikFragment.glsl"));
+  s_simulation sim;
+  sim.rubik = make_rubik(&sim.cubies, false);
 
   int maxFrames = 144;
 
@@ -46,128 +98,247 @@ int main() {
   auto lastTime = std::chrono::high_resolution_clock::now();
   double frameRate = 1000.0 / maxFrames;
 
-  int rotateCounter = 0;
-  int pressCounter = 0;
+  engine::LatencyTracker latency;
+  latency.init();
+
+  engine::Overlay overlay;
+  overlay.init(assets, "../src/shaders/overlayVertex.glsl", "../src/shaders/overlayFragment.glsl");
+  overlay.setVisible(options.overlay);
+  s_hud hud;
+  if (options.frame_budget_ms > 0.0f)
+    hud.budget_ms = options.frame_budget_ms;
+  std::size_t queuedMoves = 0;
+  int perspectiveW = 0, perspectiveH = 0;
+  float perspectiveFar = 0.0f;
+  std::size_t perspectiveMeshes = 0;
+  engine::RenderQueue renderQueue(jobs.slots());
+  auto frameStart = engine::now_ns();
+
+  engine::Profiler::setThreadName("render");
+  engine::Profiler::setEnabled(options.profile);
+
+  // session recording/replay, driven by simulation ticks
+  sim.replaying = !options.replay_path.empty();
+  sim.max_speed = sim.replaying && options.replay_speed == REPLAY_MAX;
+
+  if (!options.record_path.empty() && !sim.recorder.open(options.record_path.c_str(), kTickRate))
+    return -1;
+  if (sim.replaying && !sim.replay.open(options.replay_path.c_str()))
+    return -1;
+  if (sim.replaying && sim.replay.tickRate() != kTickRate)
+    std::cerr << "REPLAY::WARNING: recorded at " << sim.replay.tickRate()
+              << " ticks/s, replaying at " << kTickRate << std::endl;
+  s_stress stress;
+  stress.levels = options.stress_levels;
+  stress.seconds = options.stress_seconds;
+  if (stress.active()) {
+    stress_build(&stress, &sim, &rubik, stress.levels[0]);
+    stress_print_header(std::cout);
+  }
+  // timed whenever --stress or --dynamic-res need the GPU side of the frame, else only with
+  // the profiler; named after the AA mode so a trace shows what the mode costs
+  const bool gpuTimed = stress.active() || options.dynamic_res;
+  engine::GpuZoneTimer sceneTimer(kAntiAliasingZones[options.aa], gpuTimed);
+  engine::PostProcess post(options.dynamic_res ? aa_samples(options.aa) : 0, gpuTimed);
+  if (options.aa == AA_FXAA)
+    post.init(assets, "../src/shaders/fxaaVertex.glsl", "../src/shaders/fxaaFragment.glsl");
+  const bool offscreen = options.aa == AA_FXAA || options.dynamic_res;
+  engine::DynamicResolution resolution;
+  resolution.configure(options.dynamic_res ? options.res_min : 1.0f, options.dynamic_res ? options.res_max : 1.0f,
+                       hud.budget_ms);
+
+  if (sim.max_speed || stress.active())
+    glfwSwapInterval(0);
+  auto replayStart = engine::now_ns();
+
+  s_capture capture;
+  capture.every = options.capture_every;
+  std::uint64_t frameIndex = 0;
 
-  bool is_rotating = false;
-  bool is_reversed = false;
+  engine::MetricsExporter metrics;
+  if (!options.metrics_target.empty() && !metrics.start(options.metrics_target, options.metrics_interval))
+    return -1;
 
-  RubikRoteGroup group = FRONT;
+  std::thread simThread(simulation_thread, &sim);
+  engine::ThreadLoad renderLoad;
+  renderLoad.start();
 
-  while (!glfwWindowShouldClose(window)) {
+  while (!glfwWindowShouldClose(window) && !sim.finished.load(std::memory_order_acquire)) {
     auto timePoint = std::chrono::high_resolution_clock::now();
 
-    // input/process animation
-    // rotate
-    if (glfwGetKey(window, GLFW_KEY_RIGHT) == GLFW_PRESS) {
-      for (auto& cube : rubik.cubes)
-        cube->rotate(glm::vec3(0.0f, 1.0f, 0.0f), 1.0f);
-    } else if (glfwGetKey(window, GLFW_KEY_LEFT) == GLFW_PRESS) {
-      for (auto& cube : rubik.cubes)
-        cube->rotate(glm::vec3(0.0f, 1.0f, 0.0f), -1.0f);
-    } else if (glfwGetKey(window, GLFW_KEY_UP) == GLFW_PRESS) {
-      for (auto& cube : rubik.cubes)
-        cube->rotate(glm::vec3(1.0f, 0.0f, 0.0f), 1.0f);
-    } else if (glfwGetKey(window, GLFW_KEY_DOWN) == GLFW_PRESS) {
-      for (auto& cube : rubik.cubes)
-        cube->rotate(glm::vec3(1.0f, 0.0f, 0.0f), -1.0f);
-    } else if (glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS) {
-      if (!is_rotating) {
-        rotateCounter = 90;
-        group = FRONT;
-        is_rotating = true;
-      }
-    } else if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) {
-      if (!is_rotating) {
-        rotateCounter = 90;
-        group = BACK;
-        is_rotating = true;
-      }
-    } else if (glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS) {
-      if (!is_rotating) {
-        rotateCounter = 90;
-        group = RIGHT;
-        is_rotating = true;
-      }
-    } else if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) {
-      if (!is_rotating) {
-        rotateCounter = 90;
-        group = LEFT;
-        is_rotating = true;
-      }
-    } else if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) {
-      if (!is_rotating) {
-        rotateCounter = 90;
-        group = TOP;
-        is_rotating = true;
-      }
-    } else if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) {
-      if (!is_rotating) {
-        rotateCounter = 90;
-        group = BOTTOM;
-        is_rotating = true;
-      }
-    } else if (glfwGetKey(window, GLFW_KEY_Z) == GLFW_PRESS) {
-      if (!is_rotating) {
-        rotateCounter = 90;
-        group = CENTER_F;
-        is_rotating = true;
-      }
-    } else if (glfwGetKey(window, GLFW_KEY_X) == GLFW_PRESS) {
-      if (!is_rotating) {
-        rotateCounter = 90;
-        group = CENTER_R;
-        is_rotating = true;
-      }
-    } else if (glfwGetKey(window, GLFW_KEY_C) == GLFW_PRESS) {
-      if (!is_rotating) {
-        rotateCounter = 90;
-        group = CENTER_T;
-        is_rotating = true;
+    // input goes straight to the simulation thread
+    glfwPollEvents();
+    renderLoad.begin();
+    auto cpuStart = engine::now_ns();
+    PROFILE_ZONE("frame");
+    assets.update();
+
+    RubikAction command;
+    while (sim.commands.pop(command)) {
+      switch (command) {
+        case ACTION_REPORT_LATENCY:
+          latency.report(std::cout);
+          std::cout << "simulation thread: " << sim.load.utilization() * 100.0 << "% busy, "
+                    << "render thread: " << renderLoad.utilization() * 100.0 << "% busy" << std::endl;
+          latency.writeLog("latency.log");
+          break;
+        case ACTION_TOGGLE_PROFILER:
+          engine::Profiler::setEnabled(!engine::Profiler::enabled());
+          std::cout << "profiler " << (engine::Profiler::enabled() ? "on" : "off") << std::endl;
+          break;
+        case ACTION_REPORT_GL:
+          engine::GLTrace::report(std::cout);
+          engine::GLRegistry::report(std::cout);
+          break;
+        case ACTION_TOGGLE_OVERLAY:
+          overlay.setVisible(!overlay.visible());
+          break;
+        case ACTION_CAPTURE:
+          capture.requested = true;
+          break;
+        case ACTION_DUMP_TRACE:
+          if (engine::Profiler::writeChromeTrace("trace.json", options.trace_seconds))
+            std::cout << "wrote the last " << options.trace_seconds << " s to trace.json" << std::endl;
+          break;
+        default:
+          break;
       }
     }
 
-    if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS) {
-      if (pressCounter <= 0 && !is_rotating) {
-        is_reversed = !is_reversed;
-        pressCounter = 60;
+    // pick up the newest simulation state, never waiting for it
+    if (sim.snapshots.acquire()) {
+      PROFILE_ZONE("apply_snapshot");
+      const s_render_snapshot& snapshot = sim.snapshots.front();
+      apply_snapshot(&scene, snapshot);
+      // the puzzle nodes take the view rotation, their cubies follow in update_entities
+      rubik.model = snapshot.model;
+      scene.graph.setLocal(rubik.node, glm::translate(glm::mat4(1.0f), stress.offset(0)) * snapshot.model);
+      for (std::size_t i = 0; i < stress.render.size(); ++i)
+        scene.graph.setLocal(stress.render[i].node,
+                             glm::translate(glm::mat4(1.0f), stress.offset(i + 1)) * snapshot.model);
+      // a new turn rebuilds the puzzle's static batch
+      if (snapshot.turns.size() == 1 + stress.render.size()) {
+        rubik.turns = snapshot.turns[0];
+        for (std::size_t i = 0; i < stress.render.size(); ++i)
+          stress.render[i].turns = snapshot.turns[i + 1];
+      }
+      queuedMoves = snapshot.queued_moves;
+
+      const s_turn_shown* turn;
+      while ((turn = sim.shown.peek()) && turn->tick < snapshot.tick) {
+        latency.markShown(turn->input_ns);
+        s_turn_shown done;
+        sim.shown.pop(done);
       }
     }
 
-    if (rotateCounter > 0) {
-      rotate_rubik(&rubik, group, is_reversed);
-      rotateCounter -= 1;
-    } else {
-      is_rotating = false;
+    {
+      PROFILE_ZONE("update_entities");
+      engine::update_entities(scene);
     }
 
-    // set perspective
+    // set perspective, only when the window, the far plane or the meshes changed
     int w, h;
     glfwGetWindowSize(window, &w, &h);
-    for (auto& cube : rubik.cubes) {
-      cube->setPerspective(45.0f, (float)w / (float)h, 0.1f, 100.0f);
+    if (w != perspectiveW || h != perspectiveH || stress.far_plane != perspectiveFar ||
+        scene.meshes.size() != perspectiveMeshes) {
+      for (auto* mesh : scene.meshes) {
+        mesh->setPerspective(45.0f, (float)w / (float)h, 0.1f, stress.far_plane);
+      }
+      perspectiveW = w;
+      perspectiveH = h;
+      perspectiveFar = stress.far_plane;
+      perspectiveMeshes = scene.meshes.size();
     }
+    const engine::Camera& camera = scene.meshes[0]->getCamera();
+    glm::mat4 viewProjection = camera.getProjection() * camera.getView();
+
+    int fbw, fbh;
+    glfwGetFramebufferSize(window, &fbw, &fbh);
+    if (offscreen)
+      post.begin(resolution.scaled(fbw), resolution.scaled(fbh));
 
     // set background color
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
     // draw cubes
-    for (auto cube : rubik.cubes) {
-      cube->useCamera();
-      cube->draw();
+    {
+      PROFILE_ZONE("draw");
+      engine::GpuZone sceneZone(sceneTimer);
+      queue_rubik(rubik, camera.getView(), viewProjection, renderQueue, jobs.threadIndex());
+      // the stress puzzles are culled and queued on every core
+      jobs.parallel_for(0, stress.render.size(), 32, [&](std::size_t begin, std::size_t end) {
+        std::size_t producer = jobs.threadIndex();
+        for (std::size_t i = begin; i < end; ++i)
+          queue_rubik(stress.render[i], camera.getView(), viewProjection, renderQueue, producer);
+      });
+      renderQueue.sort();
+      renderQueue.submit(camera.getView(), camera.getProjection());
+      renderQueue.clear();
     }
+    if (offscreen)
+      post.end(fbw, fbh);
+
+    // frames read back earlier go to disk, this one is queued before the overlay covers it;
+    // offscreen the target is read at render resolution
+    capture_collect(&capture, jobs);
+    if (offscreen)
+      capture_request(&capture, post.output().fbo(), post.output().width(), post.output().height(), frameIndex);
+    else
+      capture_request(&capture, 0, fbw, fbh, frameIndex);
+    frameIndex++;
+
+    overlay.draw(fbw, fbh);
 
     if (canColorChange)
       canColorChange = false;
 
+    latency.frameSubmitted();
+    renderLoad.end();
+    auto cpuEnd = engine::now_ns();
     glfwSwapBuffers(window);
-    glfwPollEvents();
+    latency.framePresented(engine::now_ns());
+
+    engine::FrameStats::endFrame();
+    engine::GLTrace::endFrame();
+    engine::FrameArena::thread().reset();
+    auto frameEnd = engine::now_ns();
+    float frameMs = (float)(frameEnd - frameStart) / 1e6f;
+    update_hud(&hud, &overlay, frameMs,
+               {queuedMoves, sim.load.utilization(), renderLoad.utilization(), kAntiAliasingNames[options.aa],
+                resolution.scale()});
+    engine::Metrics::frame(frameMs, hud.budget_ms);
+    frameStart = frameEnd;
+
+    // the frame rate cap sleeps, so the scale follows the work: render thread CPU time or
+    // the GPU time of the scene and post pass, whichever is longer
+    std::int64_t gpuNs = sceneTimer.lastNs() + (offscreen ? post.lastNs() : 0);
+    if (options.dynamic_res)
+      resolution.update(std::max((float)(cpuEnd - cpuStart), (float)gpuNs) / 1e6f);
+
+    if (stress.active()) {
+      stress_sample(&stress, frameMs, (float)(cpuEnd - cpuStart) / 1e6f, (float)gpuNs / 1e6f);
+      if (stress_level_done(stress)) {
+        stress_report(stress, sim, std::cout);
+        if (stress.levels.size() > 1) {
+          if (++stress.level == stress.levels.size())
+            break;
+          // the puzzles are rebuilt with the simulation thread stopped
+          sim.running.store(false, std::memory_order_release);
+          simThread.join();
+          stress_build(&stress, &sim, &rubik, stress.levels[stress.level]);
+          sim.running.store(true, std::memory_order_release);
+          simThread = std::thread(simulation_thread, &sim);
+        } else {
+          stress_restart_window(&stress);
+        }
+      }
+    }
 
-    pressCounter--;
     // delay rendering to get set number of fps
     auto diff = std::chrono::duration<double>(timePoint - lastTime).count();
-    if (diff < frameRate) {
+    if (!sim.max_speed && !stress.active() && diff < frameRate) {
       std::this_thread::sleep_for(std::chrono::milliseconds((int)(frameRate - diff)));
       // delay color change
       if(count++ > 30) {
@@ -178,9 +349,41 @@ int main() {
     lastTime = timePoint;
   }
 
+  sim.running.store(false, std::memory_order_release);
+  simThread.join();
+  metrics.stop();
+
+  latency.writeLog("latency.log");
+  std::cout << "simulation thread: " << sim.load.utilization() * 100.0 << "% busy ("
+            << sim.load.busyMsPerIteration() << " ms/tick), render thread: "
+            << renderLoad.utilization() * 100.0 << "% busy ("
+            << renderLoad.busyMsPerIteration() << " ms/frame)" << std::endl;
+
+  std::uint64_t checksum = rubik_checksum(sim.rubik);
+  if (sim.recorder.isOpen()) {
+    sim.recorder.finish(sim.tick, checksum);
+    std::cout << "recorded " << sim.recorder.events() << " events over " << sim.tick
+              << " ticks to " << options.record_path << std::endl;
+  }
+  if (sim.replaying) {
+    double seconds = (double)(engine::now_ns() - replayStart) / 1e9;
+    std::cout << "replayed " << sim.tick << " ticks in " << seconds << " s ("
+              << (double)sim.tick / seconds << " ticks/s)" << std::endl;
+    if (sim.replay.hasEnd() && sim.replay.checksum() != checksum)
+      std::cerr << "REPLAY::ERROR: final state differs from the recording" << std::endl;
+  }
+
   // clean up
-  for (auto& cube : rubik.cubes)
-    delete cube;
+  capture_release(&capture, jobs);
+  stress_free(&stress, &sim);
+  free_rubik(&rubik);
+  assets.release();
+  latency.release();
+  overlay.release();
+  post.release();
+  engine::Profiler::releaseGpu();
+  scene.release();
+  engine::GLRegistry::reportLeaks(std::cerr);
   glfwTerminate();
   return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,222 @@
+#ifndef CUBE_SRC_OPTIONS_H_
+#define CUBE_SRC_OPTIONS_H_
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+enum ReplaySpeed {
+  REPLAY_REALTIME = 0,
+  REPLAY_MAX = 1,
+};
+
+enum OptionsResult {
+  OPTIONS_RUN = 0,
+  OPTIONS_HELP = 1,  // --help, exits with status 0
+  OPTIONS_ERROR = 2, // a bad option, exits with status 2 so scripts notice
+};
+
+enum AntiAliasing {
+  AA_OFF = 0,
+  AA_MSAA2 = 1,
+  AA_MSAA4 = 2,
+  AA_MSAA8 = 3,
+  AA_FXAA = 4,
+  AA_COUNT,
+};
+
+// --aa values, also shown by the overlay
+constexpr const char* kAntiAliasingNames[AA_COUNT] = {"off", "msaa2", "msaa4", "msaa8", "fxaa"};
+// name of the scene's GPU zone, so the profiler shows what each mode costs
+constexpr const char* kAntiAliasingZones[AA_COUNT] = {"scene (aa off)", "scene (msaa2)", "scene (msaa4)",
+                                                      "scene (msaa8)", "scene (fxaa)"};
+
+// samples of the default framebuffer, 0 for the modes without MSAA
+constexpr int aa_samples(AntiAliasing aa) {
+  switch (aa) {
+    case AA_MSAA2:
+      return 2;
+    case AA_MSAA4:
+      return 4;
+    case AA_MSAA8:
+      return 8;
+    default:
+      return 0;
+  }
+}
+
+struct s_options {
+  std::string record_path;
+  std::string replay_path;
+  ReplaySpeed replay_speed = REPLAY_REALTIME;
+  bool headless = false;
+  bool profile = false;
+  bool overlay = false;
+  bool gl_trace = false;
+  double trace_seconds = 10.0;
+  std::vector<std::size_t> stress_levels; // puzzle counts for --stress
+  double stress_seconds = 5.0;
+  std::string metrics_target; // file path or unix:SOCKET
+  double metrics_interval = 10.0;
+  unsigned threads = 0; // job system threads, 0 uses every hardware thread
+  AntiAliasing aa = AA_OFF;
+  bool dynamic_res = false; // scale the scene's resolution to hold frame_budget_ms
+  float res_min = 0.5f, res_max = 1.0f;
+  float frame_budget_ms = 0.0f; // 0 keeps the frame rate cap's budget
+  std::uint64_t capture_every = 0; // frames between captures, 0 for F12 only
+  bool hot_reload = false; // rebuild shaders when their files change
+};
+
+void print_usage(const char* name) {
+  std::cout << "usage: " << name << " [options]\n"
+            << "  --record=FILE        record every input event to FILE\n"
+            << "  --replay=FILE        replay a recorded session instead of live input\n"
+            << "  --replay-speed=MODE  realtime (default) or max\n"
+            << "  --headless           run without showing a window\n"
+            << "  --profile            start with the frame profiler enabled (F9 toggles)\n"
+            << "  --trace-seconds=N    seconds of history written by 'p' to trace.json\n"
+            << "  --overlay            start with the performance overlay shown (F1 toggles)\n"
+            << "  --gl-trace           count GL calls, buffer uploads and objects per frame ('g' prints)\n"
+            << "  --stress=N           draw N puzzles turning at random and report frame, CPU and GPU time\n"
+            << "  --stress=sweep       the same for 1, 10, 100, 1000 and 10000 puzzles, then exit\n"
+            << "  --stress-seconds=S   length of one stress measurement (default 5)\n"
+            << "  --metrics=FILE       write Prometheus metrics to FILE (or serve them on unix:SOCKET)\n"
+            << "  --metrics-interval=S seconds between metric updates (default 10)\n"
+            << "  --threads=N          threads of the job system, render thread included (default: all cores)\n"
+            << "  --aa=MODE            anti-aliasing: off (default), msaa2, msaa4, msaa8 or fxaa\n"
+            << "  --dynamic-res[=A-B]  render the scene at 0.5-1.0 (or A-B) of the window size to hold the budget\n"
+            << "  --frame-budget=MS    frame time that --dynamic-res holds and the overlay graph marks\n"
+            << "  --capture-every=N    save every Nth frame to capture_FRAME.ppm (F12 saves the next one)\n"
+            << "  --hot-reload         rebuild shaders when a file in src/shaders is saved\n";
+}
+
+// OPTIONS_RUN to start, otherwise the program exits right away
+OptionsResult parse_options(int argc, char** argv, s_options* options) {
+  for (int i = 1; i < argc; ++i) {
+    const char* arg = argv[i];
+    const char* value = std::strchr(arg, '=');
+    std::string key = value ? std::string(arg, value - arg) : std::string(arg);
+    value = value ? value + 1 : "";
+
+    if (key == "--record") {
+      if (!*value) {
+        std::cerr << "ERROR::OPTIONS::BAD_RECORD " << arg << std::endl;
+        return OPTIONS_ERROR;
+      }
+      options->record_path = value;
+    } else if (key == "--replay") {
+      if (!*value) {
+        std::cerr << "ERROR::OPTIONS::BAD_REPLAY " << arg << std::endl;
+        return OPTIONS_ERROR;
+      }
+      options->replay_path = value;
+    } else if (key == "--replay-speed") {
+      if (std::strcmp(value, "max") == 0) {
+        options->replay_speed = REPLAY_MAX;
+      } else if (std::strcmp(value, "realtime") == 0) {
+        options->replay_speed = REPLAY_REALTIME;
+      } else {
+        std::cerr << "ERROR::OPTIONS::BAD_REPLAY_SPEED " << value << std::endl;
+        return OPTIONS_ERROR;
+      }
+    } else if (key == "--headless") {
+      options->headless = true;
+    } else if (key == "--profile") {
+      options->profile = true;
+    } else if (key == "--overlay") {
+      options->overlay = true;
+    } else if (key == "--gl-trace") {
+      options->gl_trace = true;
+    } else if (key == "--trace-seconds") {
+      options->trace_seconds = std::atof(value);
+      if (options->trace_seconds <= 0.0) {
+        std::cerr << "ERROR::OPTIONS::BAD_TRACE_SECONDS " << value << std::endl;
+        return OPTIONS_ERROR;
+      }
+    } else if (key == "--stress") {
+      if (std::strcmp(value, "sweep") == 0) {
+        options->stress_levels = {1, 10, 100, 1000, 10000};
+      } else {
+        long count = std::atol(value);
+        if (count < 1) {
+          std::cerr << "ERROR::OPTIONS::BAD_STRESS " << value << std::endl;
+          return OPTIONS_ERROR;
+        }
+        options->stress_levels = {(std::size_t)count};
+      }
+    } else if (key == "--stress-seconds") {
+      options->stress_seconds = std::atof(value);
+      if (options->stress_seconds <= 0.0) {
+        std::cerr << "ERROR::OPTIONS::BAD_STRESS_SECONDS " << value << std::endl;
+        return OPTIONS_ERROR;
+      }
+    } else if (key == "--metrics") {
+      if (!*value) {
+        std::cerr << "ERROR::OPTIONS::BAD_METRICS " << arg << std::endl;
+        return OPTIONS_ERROR;
+      }
+      options->metrics_target = value;
+    } else if (key == "--metrics-interval") {
+      options->metrics_interval = std::atof(value);
+      if (options->metrics_interval <= 0.0) {
+        std::cerr << "ERROR::OPTIONS::BAD_METRICS_INTERVAL " << value << std::endl;
+        return OPTIONS_ERROR;
+      }
+    } else if (key == "--threads") {
+      long threads = std::atol(value);
+      if (threads < 1) {
+        std::cerr << "ERROR::OPTIONS::BAD_THREADS " << value << std::endl;
+        return OPTIONS_ERROR;
+      }
+      options->threads = (unsigned)threads;
+    } else if (key == "--aa") {
+      int mode = 0;
+      while (mode < AA_COUNT && std::strcmp(value, kAntiAliasingNames[mode]) != 0)
+        mode++;
+      if (mode == AA_COUNT) {
+        std::cerr << "ERROR::OPTIONS::BAD_AA " << value << std::endl;
+        return OPTIONS_ERROR;
+      }
+      options->aa = (AntiAliasing)mode;
+    } else if (key == "--dynamic-res") {
+      options->dynamic_res = true;
+      if (*value) {
+        const char* dash = std::strchr(value, '-');
+        options->res_min = (float)std::atof(value);
+        options->res_max = dash ? (float)std::atof(dash + 1) : 0.0f;
+        if (options->res_min <= 0.0f || options->res_max > 1.0f || options->res_min > options->res_max) {
+          std::cerr << "ERROR::OPTIONS::BAD_DYNAMIC_RES " << value << std::endl;
+          return OPTIONS_ERROR;
+        }
+      }
+    } else if (key == "--frame-budget") {
+      options->frame_budget_ms = (float)std::atof(value);
+      if (options->frame_budget_ms <= 0.0f) {
+        std::cerr << "ERROR::OPTIONS::BAD_FRAME_BUDGET " << value << std::endl;
+        return OPTIONS_ERROR;
+      }
+    } else if (key == "--capture-every") {
+      long every = std::atol(value);
+      if (every < 1) {
+        std::cerr << "ERROR::OPTIONS::BAD_CAPTURE_EVERY " << value << std::endl;
+        return OPTIONS_ERROR;
+      }
+      options->capture_every = (std::uint64_t)every;
+    } else if (key == "--hot-reload") {
+      options->hot_reload = true;
+    } else if (key == "--help" || key == "-h") {
+      print_usage(argv[0]);
+      return OPTIONS_HELP;
+    } else {
+      std::cerr << "ERROR::OPTIONS::UNKNOWN_OPTION " << arg << std::endl;
+      print_usage(argv[0]);
+      return OPTIONS_ERROR;
+    }
+  }
+  return OPTIONS_RUN;
+}
+
+#endif // CUBE_SRC_OPTIONS_H_
@@ -0,0 +1,46 @@
+#version 460 core
+
+in vec2 vUv;
+
+out vec4 fragColor;
+
+uniform sampler2D scene;
+uniform vec2 texel; // 1 / target size
+
+// FXAA in its short form: find how much contrast the pixel's neighbourhood
+// has, skip flat areas, otherwise blend along the edge direction
+const float kReduceMin = 1.0 / 128.0;
+const float kReduceMul = 1.0 / 8.0;
+const float kSpanMax = 8.0;
+
+float luma(vec3 c) {
+    return dot(c, vec3(0.299, 0.587, 0.114));
+}
+
+void main() {
+    vec3 rgbM = texture(scene, vUv).rgb;
+    float lumaNW = luma(texture(scene, vUv + vec2(-1.0, -1.0) * texel).rgb);
+    float lumaNE = luma(texture(scene, vUv + vec2(1.0, -1.0) * texel).rgb);
+    float lumaSW = luma(texture(scene, vUv + vec2(-1.0, 1.0) * texel).rgb);
+    float lumaSE = luma(texture(scene, vUv + vec2(1.0, 1.0) * texel).rgb);
+    float lumaM = luma(rgbM);
+
+    float lumaMin = min(lumaM, min(min(lumaNW, lumaNE), min(lumaSW, lumaSE)));
+    float lumaMax = max(lumaM, max(max(lumaNW, lumaNE), max(lumaSW, lumaSE)));
+    if (lumaMax - lumaMin < max(0.0312, lumaMax * 0.125)) {
+        fragColor = vec4(rgbM, 1.0);
+        return;
+    }
+
+    vec2 dir = vec2(-((lumaNW + lumaNE) - (lumaSW + lumaSE)), (lumaNW + lumaSW) - (lumaNE + lumaSE));
+    float reduce = max((lumaNW + lumaNE + lumaSW + lumaSE) * 0.25 * kReduceMul, kReduceMin);
+    float scale = 1.0 / (min(abs(dir.x), abs(dir.y)) + reduce);
+    dir = clamp(dir * scale, vec2(-kSpanMax), vec2(kSpanMax)) * texel;
+
+    vec3 rgbA = 0.5 * (texture(scene, vUv + dir * (1.0 / 3.0 - 0.5)).rgb +
+                       texture(scene, vUv + dir * (2.0 / 3.0 - 0.5)).rgb);
+    vec3 rgbB = rgbA * 0.5 + 0.25 * (texture(scene, vUv - dir * 0.5).rgb +
+                                     texture(scene, vUv + dir * 0.5).rgb);
+    float lumaB = luma(rgbB);
+    fragColor = vec4(lumaB < lumaMin || lumaB > lumaMax ? rgbA : rgbB, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,12 @@
+#version 460 core
+
+in vec2 vUv;
+in vec4 vColor;
+
+out vec4 fragColor;
+
+uniform sampler2D atlas;
+
+void main() {
+    fragColor = vec4(vColor.rgb, vColor.a * texture(atlas, vUv).r);
+}
@@ -0,0 +1,17 @@
+#version 460 core
+
+layout (location = 0) in vec2 position;
+layout (location = 1) in vec2 uv;
+layout (location = 2) in vec4 color;
+
+out vec2 vUv;
+out vec4 vColor;
+
+uniform vec2 screen;
+
+void main() {
+    vec2 ndc = position / screen * 2.0 - 1.0;
+    gl_Position = vec4(ndc.x, -ndc.y, 0.0, 1.0);
+    vUv = uv;
+    vColor = color;
+}
@@ -1,10 +1,32 @@
 #version 460 core
 
 in vec3 vColor;
-in float vEdge;
+in vec2 vEdge;
 
 out vec4 fragColor;
 
+// sticker size and corner radius in face units (the face spans -1..1)
+const float kSticker = 0.86;
+const float kRadius = 0.18;
+// width of the darkened rim of the black plastic
+const float kBevel = 0.12;
+const vec3 kPlastic = vec3(0.02);
+
+// signed distance to a box of half size `b` with corners rounded by `r`
+float roundedBox(vec2 p, vec2 b, float r) {
+    vec2 q = abs(p) - b + r;
+    return length(max(q, 0.0)) + min(max(q.x, q.y), 0.0) - r;
+}
+
 void main() {
-    fragColor = vec4(vColor, 1.0f);
+    float d = roundedBox(vEdge, vec2(kSticker), kRadius);
+    // one pixel of coverage blending instead of a hard edge
+    float aa = fwidth(d);
+    float sticker = 1.0 - smoothstep(-aa, aa, d);
+
+    // the plastic gets darker towards the cubie's edge, like a bevel
+    float rim = max(abs(vEdge.x), abs(vEdge.y));
+    vec3 plastic = kPlastic * (1.0 - 0.5 * smoothstep(1.0 - kBevel, 1.0, rim));
+
+    fragColor = vec4(mix(plastic, vColor, sticker), 1.0f);
 }
\ No newline at end of file
@@ -2,15 +2,42 @@
 
 layout (location = 0) in vec3 position;
 layout (location = 1) in vec3 color;
+layout (location = 2) in vec2 uv;
+layout (location = 3) in vec3 normal;
 
 out vec3 vColor;
-out float vEdge;
+out vec2 vEdge;
 
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
 
+// 0 draws the per-vertex colors of a StaticBatch. A box from the MeshCache
+// has normals instead: `faces` is then the CubeFace mask of the faces it
+// shows and each face takes its color from faceColors.
+uniform int faces;
+uniform vec3 faceColors[6];
+
+// the CubeFace a box normal points through
+int faceOf(vec3 n) {
+    vec3 a = abs(n);
+    if (a.x >= a.y && a.x >= a.z)
+        return n.x > 0.0 ? 1 : 3;
+    if (a.y >= a.z)
+        return n.y > 0.0 ? 4 : 5;
+    return n.z > 0.0 ? 0 : 2;
+}
+
 void main() {
     gl_Position = projection * view * model * vec4(position, 1.0);
-    vColor = color;
+    vEdge = uv * 2.0 - 1.0; // -1..1 across the face, 0 in its middle
+    if (faces == 0) {
+        vColor = color;
+        return;
+    }
+    int face = faceOf(normal);
+    vColor = faceColors[face];
+    // a hidden face collapses to a point and makes no fragments
+    if ((faces & (1 << face)) == 0)
+        gl_Position = vec4(0.0);
 }
\ No newline at end of file
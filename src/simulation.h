@@ -0,0 +1,171 @@
+#ifndef CUBE_SRC_SIMULATION_H_
+#define CUBE_SRC_SIMULATION_H_
+
+#include <atomic>
+#include <cstdint>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "glm/glm.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+
+#include "engine/Input.h"
+#include "engine/Memory.h"
+#include "engine/Metrics.h"
+#include "engine/Profiler.h"
+#include "engine/Recorder.h"
+#include "engine/SpscQueue.h"
+#include "engine/ThreadLoad.h"
+#include "engine/TripleBuffer.h"
+
+#include "callbacks.h"
+
+// simulation steps per second, one degree of a turn per step
+constexpr int kTickRate = 144;
+
+// a turn that started at `tick`, queued by a key event at `input_ns`
+struct s_turn_shown {
+  std::uint64_t tick = 0;
+  std::int64_t input_ns = 0;
+};
+
+// everything the render thread needs to draw one simulation tick
+struct s_render_snapshot {
+  std::uint64_t tick = 0;
+  std::size_t puzzles = 1;
+  std::vector<glm::mat4> transforms; // puzzle space transform per cube, puzzle after puzzle
+  std::vector<std::uint32_t> turns;  // s_rubik::turns per puzzle
+  glm::mat4 model{1.0f};
+  std::size_t queued_moves = 0;
+};
+
+struct s_simulation {
+  engine::EntityStore cubies; // every puzzle of the simulation, GL-free
+  s_rubik rubik;
+  s_controls controls;
+  std::uint64_t tick = 0;
+
+  // --stress: extra puzzles; they and `rubik` get random turns whenever idle
+  std::vector<s_rubik> stress;
+  bool stressing = false;
+  std::mt19937 rng{0x52554249};
+
+  engine::SessionRecorder recorder;
+  engine::SessionReplay replay;
+  bool replaying = false;
+  bool max_speed = false;
+
+  // simulation -> render
+  engine::TripleBuffer<s_render_snapshot> snapshots;
+  engine::SpscQueue<s_turn_shown, 256> shown;
+  engine::SpscQueue<RubikAction, 64> commands;
+
+  std::atomic<bool> running{true};
+  std::atomic<bool> finished{false};
+  engine::ThreadLoad load;
+};
+
+// one fixed simulation step: consume input, advance the animation
+void simulate_tick(s_simulation *sim) {
+  PROFILE_FUNCTION();
+  engine::s_input_event event;
+  while (input_queue.pop(event)) {
+    if (sim->replaying)
+      continue; // live input is ignored while a session is replayed
+    sim->recorder.record(sim->tick, event);
+    handle_input_event(&sim->rubik, &sim->controls, event);
+  }
+
+  if (sim->replaying) {
+    bool idle = sim->rubik.remaining <= 0 && sim->rubik.moves.empty();
+    if (sim->replay.done(sim->tick) && (sim->replay.hasEnd() || idle)) {
+      sim->finished.store(true, std::memory_order_release);
+      return;
+    }
+    while (sim->replay.poll(sim->tick, event))
+      handle_input_event(&sim->rubik, &sim->controls, event);
+  }
+
+  for (RubikAction command : sim->controls.commands)
+    sim->commands.push(command);
+  sim->controls.commands.clear();
+
+  apply_held_keys(&sim->rubik, sim->controls);
+  if (sim->stressing) {
+    std::uniform_int_distribution<int> group(FRONT, CENTER_T);
+    auto turn = [&](s_rubik* rubik) {
+      if (rubik->remaining <= 0 && rubik->moves.empty())
+        rubik->moves.push_back({(RubikRoteGroup)group(sim->rng), (sim->rng() & 1) != 0, 0});
+    };
+    turn(&sim->rubik);
+    for (auto& puzzle : sim->stress) {
+      turn(&puzzle);
+      if (step_rubik(&puzzle))
+        engine::Metrics::moveStarted();
+    }
+  }
+  if (step_rubik(&sim->rubik)) {
+    // stress turns come from no input and are not measured
+    if (sim->rubik.current.input_ns)
+      sim->shown.push({sim->tick, sim->rubik.current.input_ns});
+    engine::Metrics::moveStarted();
+  }
+  engine::update_entities(sim->cubies);
+  sim->tick++;
+}
+
+void publish_snapshot(s_simulation *sim) {
+  PROFILE_FUNCTION();
+  s_render_snapshot& snapshot = sim->snapshots.back();
+  snapshot.tick = sim->tick;
+  snapshot.puzzles = 1 + sim->stress.size();
+  // simulation puzzle nodes stay at identity, so world matrices are in puzzle space
+  snapshot.transforms.resize(sim->cubies.size());
+  for (std::size_t i = 0; i < sim->cubies.size(); ++i)
+    snapshot.transforms[i] = sim->cubies.graph.world(sim->cubies.nodes[i]);
+  snapshot.turns.resize(snapshot.puzzles);
+  snapshot.turns[0] = sim->rubik.turns;
+  for (std::size_t i = 0; i < sim->stress.size(); ++i)
+    snapshot.turns[i + 1] = sim->stress[i].turns;
+  snapshot.model = sim->rubik.model;
+  snapshot.queued_moves = sim->rubik.moves.size() + (sim->rubik.remaining > 0 ? 1 : 0);
+  sim->snapshots.publish();
+}
+
+// fixed-rate simulation loop, runs until `running` is cleared or a replay ends
+void simulation_thread(s_simulation *sim) {
+  using clock = std::chrono::steady_clock;
+  const auto period = std::chrono::nanoseconds(1'000'000'000 / kTickRate);
+  auto next = clock::now();
+
+  engine::Profiler::setThreadName("simulation");
+  sim->load.start();
+  while (sim->running.load(std::memory_order_acquire) &&
+         !sim->finished.load(std::memory_order_acquire)) {
+    sim->load.begin();
+    simulate_tick(sim);
+    publish_snapshot(sim);
+    engine::FrameArena::thread().reset();
+    sim->load.end();
+
+    if (sim->max_speed)
+      continue;
+    next += period;
+    auto now = clock::now();
+    if (next < now - period * 4)
+      next = now; // fell far behind, do not try to catch up in a burst
+    std::this_thread::sleep_until(next);
+  }
+}
+
+// copy a snapshot into the render store, which holds the same puzzles in
+// the same order as the simulation's; the cubies become children of their
+// render puzzle node, unchanged ones stay clean
+void apply_snapshot(engine::EntityStore *store, const s_render_snapshot& snapshot) {
+  if (snapshot.transforms.size() != store->size())
+    return; // nothing published yet, or published for another puzzle count
+  engine::set_transforms(*store, 0, store->size(), snapshot.transforms.data());
+}
+
+#endif // CUBE_SRC_SIMULATION_H_
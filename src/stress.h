@@ -0,0 +1,140 @@
+#ifndef CUBE_SRC_STRESS_H_
+#define CUBE_SRC_STRESS_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <vector>
+
+#include "glm/glm.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+
+#include "engine/Input.h"
+
+#include "callbacks.h"
+#include "simulation.h"
+
+// distance between puzzle centers, a puzzle is a bit over 3 units wide
+constexpr float kStressSpacing = 4.0f;
+// frames skipped after a level starts, its first frames create the GL meshes
+constexpr std::size_t kStressWarmupFrames = 30;
+
+// --stress: N puzzles on a grid, all turning at random, drawn by the normal
+// render path. Each level runs for `seconds` and prints one report row.
+struct s_stress {
+  std::vector<std::size_t> levels; // puzzle counts, run one after another
+  std::size_t level = 0;
+  double seconds = 5.0;
+
+  std::vector<s_rubik> render;    // render copies of the extra puzzles
+  std::vector<glm::vec3> offsets; // one per puzzle, [0] is the main puzzle
+  float distance = 10.0f;         // camera distance that fits the grid
+  float far_plane = 100.0f;
+
+  std::int64_t level_start = 0;
+  std::size_t frames = 0;
+  std::vector<float> frame_ms, cpu_ms, gpu_ms;
+
+  [[nodiscard]] bool active() const {
+    return !levels.empty();
+  }
+
+  [[nodiscard]] glm::vec3 offset(std::size_t puzzle) const {
+    return puzzle < offsets.size() ? offsets[puzzle] : glm::vec3(0.0f);
+  }
+};
+
+// start a new measurement window on the same puzzles
+void stress_restart_window(s_stress *stress) {
+  stress->level_start = engine::now_ns();
+  stress->frame_ms.clear();
+  stress->cpu_ms.clear();
+  stress->gpu_ms.clear();
+}
+
+// drop the extra puzzles, newest first; the main one stays first in both stores
+void stress_free(s_stress *stress, s_simulation *sim) {
+  for (auto it = stress->render.rbegin(); it != stress->render.rend(); ++it)
+    free_rubik(&*it);
+  for (auto it = sim->stress.rbegin(); it != sim->stress.rend(); ++it)
+    free_rubik(&*it);
+  stress->render.clear();
+  sim->stress.clear();
+}
+
+// Replace the extra puzzles with `count - 1` new ones laid out on a square
+// grid around the origin. The simulation thread must not be running.
+void stress_build(s_stress *stress, s_simulation *sim, s_rubik *rubik, std::size_t count) {
+  stress_free(stress, sim);
+  auto columns = (std::size_t)std::ceil(std::sqrt((double)count));
+  auto rows = (count + columns - 1) / columns;
+  stress->offsets.clear();
+  for (std::size_t i = 0; i < count; ++i)
+    stress->offsets.emplace_back(((float)(i % columns) - (float)(columns - 1) / 2.0f) * kStressSpacing,
+                                 ((float)(rows - 1) / 2.0f - (float)(i / columns)) * kStressSpacing, 0.0f);
+
+  // fit the grid into the 45 degree field of view
+  float extent = (float)std::max(columns, rows) * kStressSpacing;
+  stress->distance = std::max(10.0f, extent / 2.0f / std::tan(glm::radians(22.5f)) * 1.1f);
+  stress->far_plane = stress->distance + 2.0f * kStressSpacing + 100.0f;
+
+  auto shader = rubik->store->meshes[rubik->first]->getShader();
+  for (std::size_t i = 1; i < count; ++i) {
+    stress->render.push_back(make_rubik(rubik->store, true, shader));
+    sim->stress.push_back(make_rubik(&sim->cubies, false));
+  }
+  // placed right away, snapshots only keep the puzzle nodes up to date
+  rubik->store->graph.setLocal(rubik->node, glm::translate(glm::mat4(1.0f), stress->offset(0)) * rubik->model);
+  for (std::size_t i = 0; i < stress->render.size(); ++i)
+    rubik->store->graph.setLocal(stress->render[i].node,
+                                 glm::translate(glm::mat4(1.0f), stress->offset(i + 1)) * rubik->model);
+  for (auto* mesh : rubik->store->meshes)
+    mesh->setViewMatrix(glm::vec3(0.0f, 0.0f, stress->distance), glm::vec3(0.0f),
+                        glm::vec3(0.0f, 1.0f, 0.0f));
+
+  sim->stressing = true;
+  stress->frames = 0;
+  stress_restart_window(stress);
+}
+
+void stress_sample(s_stress *stress, float frame_ms, float cpu_ms, float gpu_ms) {
+  if (stress->frames++ < kStressWarmupFrames) {
+    stress->level_start = engine::now_ns();
+    return;
+  }
+  stress->frame_ms.push_back(frame_ms);
+  stress->cpu_ms.push_back(cpu_ms);
+  stress->gpu_ms.push_back(gpu_ms);
+}
+
+[[nodiscard]] bool stress_level_done(const s_stress& stress) {
+  return stress.frames > kStressWarmupFrames &&
+         (double)(engine::now_ns() - stress.level_start) / 1e9 >= stress.seconds;
+}
+
+void stress_print_header(std::ostream& out) {
+  out << "puzzles   frames  frame ms    p95 ms    cpu ms    gpu ms   sim ms/tick  sim busy  bound\n";
+}
+
+void stress_report(const s_stress& stress, const s_simulation& sim, std::ostream& out) {
+  auto mean = [](const std::vector<float>& v) {
+    double sum = 0.0;
+    for (float x : v)
+      sum += x;
+    return v.empty() ? 0.0 : sum / (double)v.size();
+  };
+  std::vector<float> sorted = stress.frame_ms;
+  std::sort(sorted.begin(), sorted.end());
+  double p95 = sorted.empty() ? 0.0 : sorted[(std::size_t)(0.95 * (double)(sorted.size() - 1))];
+  double cpu = mean(stress.cpu_ms), gpu = mean(stress.gpu_ms);
+
+  char line[160];
+  std::snprintf(line, sizeof(line), "%7zu %8zu %9.2f %9.2f %9.2f %9.2f %13.3f %8.0f%%  %s\n",
+                stress.offsets.size(), stress.frame_ms.size(), mean(stress.frame_ms), p95, cpu, gpu,
+                sim.load.busyMsPerIteration(), sim.load.utilization() * 100.0, gpu > cpu ? "GPU" : "CPU");
+  out << line << std::flush;
+}
+
+#endif // CUBE_SRC_STRESS_H_